@@ -7,7 +7,7 @@ use utf8;
 use Term::ANSIColor;
 
 my ($testNumber) = @ARGV;
-my @testNs = (100, 103, 10, 14, 20, 30, 31, 34);
+my @testNs = (100, 103, 10, 11, 12, 14, 20, 21, 30, 31, 34, 60);
 
 if ($testNumber) {
 	@testNs = ($testNumber);
@@ -28,13 +28,17 @@ sub runOneTest
 	} elsif ($testN == 103) {
 		my $output = captureStdout($testN, "../src/gep2 -i 6 -h 14 -p 60 -t 30 -e 3");
 		compareStdout($testN, $output);
-	} elsif ($testN == 10 || $testN == 14 || $testN == 20 || $testN == 30 || $testN == 31 || $testN == 34
-	|| $testN == 35) {
+	} elsif ($testN == 10 || $testN == 11 || $testN == 12 || $testN == 14 || $testN == 20 || $testN == 30
+	|| $testN == 31 || $testN == 34 || $testN == 35 || $testN == 60) {
 		my $output = captureStdout($testN, "../src/quantumGep -f inputs/input$testN.ain -p 12 -S 1");
 		compareStdout($testN, $output);
 	} elsif ($testN == 36) {
 		 my $output = captureStdout($testN, "../src/quantumGep -f inputs/input35.ain -p 12 -S 4");
         compareStdout($testN, $output);
+	} elsif ($testN == 21) {
+		system("../src/hamiltonianFromText inputs/matrix22.txt matrix22.crs 1> /dev/null 2> /dev/null");
+		my $output = captureStdout($testN, "../src/quantumGep -f inputs/input$testN.ain -p 12 -S 1");
+		compareStdout($testN, $output);
 	} else {
 		die "$0: Unknown test $testN\n";
 	}
@@ -42,6 +42,23 @@ Returns the maximum fitness for this problem.
 */
 	virtual RealType maxFitness() const = 0;
 
+	// Called by the engine at the start of each generation
+	virtual void startGeneration(SizeType) {}
+
+	/* The fraction of its full budget that each candidate gets in the first round
+	   of racing, see Engine::selectBest, or 0 if the fitness does not race */
+	virtual RealType racingBudget() const { return 0; }
+
+	/* Called by the engine before each round of racing, with the fraction of the
+	   full budget for the round; later rounds resume from where the earlier stopped */
+	virtual void setRacingRound(SizeType, RealType) {}
+
+	// The fidelity of the evaluations of this generation, 1 for full fidelity
+	virtual RealType fidelity() const { return 1; }
+
+	// Evaluates at full fidelity while full is true, see Engine::selectBest
+	virtual void setFullFidelity(bool) {}
+
 	const SizeType status() const { return 0; }
 
 	virtual PsimagLite::String info(const ChromosomeType&) const
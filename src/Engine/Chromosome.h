@@ -24,11 +24,12 @@ along with evendim. If not, see <http://www.gnu.org/licenses/>.
 
 namespace Gep {
 
-template<typename TreeType, typename EvolutionType_, typename ParametersType>
+template<typename TreeType_, typename EvolutionType_, typename ParametersType>
 class Chromosome {
 
 public:
 
+	typedef TreeType_ TreeType;
 	typedef EvolutionType_ EvolutionType;
 	typedef Gene<TreeType,EvolutionType> GeneType;
 	typedef typename EvolutionType::PrimitivesType PrimitivesType;
@@ -40,18 +41,24 @@ public:
 	typedef typename PsimagLite::Vector<GeneType*>::Type VectorGeneType;
 	typedef typename GeneType::VectorStringType VectorStringType;
 	typedef Chromosome<TreeType,EvolutionType,ParametersType> ChromosomeType;
-	typedef std::pair<VectorStringType, VectorStringType> PairVectorStringType;
-	typedef typename PsimagLite::Vector<VectorStringType>::Type VectorVectorStringType;
-	typedef std::pair<VectorVectorStringType, VectorVectorStringType> PairVectorVectorStringType;
+	typedef std::pair<PackedGenome, PackedGenome> PairPackedGenomeType;
+	typedef typename PsimagLite::Vector<PackedGenome>::Type VectorPackedGenomeType;
 
 	Chromosome(const ParametersType& params,
 	           const EvolutionType& evolution,
 	           const VectorStringType& vecStr,
 	           SizeType threadNum)
+	    : Chromosome(params, evolution, evolution.pack(vecStr), threadNum)
+	{}
+
+	Chromosome(const ParametersType& params,
+	           const EvolutionType& evolution,
+	           const PackedGenome& genome,
+	           SizeType threadNum)
 	    : evolution_(evolution),
 	      params_(params)
 	{
-		SizeType len = vecStr.size();
+		SizeType len = genome.size();
 		bool hasDc = (evolution_.primitives().dcValues().size() > 0);
 		SizeType dc = (hasDc)? evolution.tail(params.head) : 0;
 
@@ -60,66 +67,46 @@ public:
 		if (len == 0)
 			throw PsimagLite::RuntimeError("Chromosome::ctor()\n");
 
-		SizeType index = 0;
-		VectorStringType buffer;
-		for (SizeType i = 0; i < geneLength; i++)
-			buffer.push_back(" ");
-
-		for (SizeType i = 0; i < len; i++) {
-			buffer[index] = vecStr[i];
-			index++;
-			if (index == geneLength) {
-				index = 0;
-				GeneType* gene = new GeneType(params.head,
-				                              false,
-				                              evolution,
-				                              buffer,
-				                              threadNum);
-				genes_.push_back(gene);
-				if (genes_.size() == params.genes) break;
-			}
+		SizeType start = 0;
+		for (; start + geneLength <= len && genes_.size() < params.genes; start += geneLength) {
+			PackedGenome buffer;
+			buffer.append(genome, start, start + geneLength);
+			GeneType* gene = new GeneType(params.head,
+			                              false,
+			                              evolution,
+			                              buffer,
+			                              threadNum);
+			genes_.push_back(gene);
+			genome_.append(buffer);
 		}
 
 		assert(genes_.size() == params.genes);
 
-		index = 0;
-
-		SizeType start = geneLength*genes_.size();
 		SizeType cgeneLength = params.chead + evolution.tail(params.chead);
 
-		buffer.clear();
-		for (SizeType i = 0; i < cgeneLength; i++)
-			buffer.push_back(" ");
-
-		for (SizeType i = start; i < len; i++) {
-			buffer[index] = vecStr[i];
-			index++;
-			if (index == cgeneLength) {
-				index = 0;
-				GeneType* gene = new GeneType(params.chead,
-				                              true,
-				                              evolution,
-				                              buffer,
-				                              threadNum);
-				adfs_.push_back(gene);
-				if (adfs_.size() == params.adfs) break;
-			}
+		for (; start + cgeneLength <= len && adfs_.size() < params.adfs; start += cgeneLength) {
+			PackedGenome buffer;
+			buffer.append(genome, start, start + cgeneLength);
+			GeneType* gene = new GeneType(params.chead,
+			                              true,
+			                              evolution,
+			                              buffer,
+			                              threadNum);
+			adfs_.push_back(gene);
 		}
 
 		for (SizeType i = 0; i < genes_.size(); i++) {
 			const SizeType effectiveSize = genes_[i]->effectiveSize();
-			ProgramGlobals::pushVector(effectiveVecStr_, genes_[i]->vecString(), effectiveSize);
+			effectiveGenome_.append(genes_[i]->genome(), 0, effectiveSize);
 		}
 
 		assert(adfs_.size() == params.adfs);
 		if (adfs_.size() == 0) return;
 		assert(adfs_.size() == 1);
 
-		adfsVecStr_ = adfs_[0]->vecString();
-		const SizeType adfsEffective = adfs_[0]->effectiveSize();
-		const VectorStringType& adfsVec = adfs_[0]->vecString();
-
-		ProgramGlobals::pushVector(effectiveVecStr_, adfsVec, adfsEffective);
+		adfsGenome_ = adfs_[0]->genome();
+		genome_.append(adfsGenome_);
+		effectiveGenome_.append(adfsGenome_, 0, adfs_[0]->effectiveSize());
 	}
 
 	~Chromosome()
@@ -139,9 +126,11 @@ public:
 
 		//		params_ = other.params_;
 
-		effectiveVecStr_ = other.effectiveVecStr_;
+		genome_ = other.genome_;
+
+		effectiveGenome_ = other.effectiveGenome_;
 
-		adfsVecStr_ = other.adfsVecStr_;
+		adfsGenome_ = other.adfsGenome_;
 
 		const SizeType n = genes_.size();
 		for (SizeType i = 0; i < n; ++i) {
@@ -160,18 +149,12 @@ public:
 
 	VectorStringType vecString() const
 	{
-		VectorStringType ret;
-
-		for (SizeType i = 0; i < genes_.size(); i++) {
-			ProgramGlobals::pushVector(ret, genes_[i]->vecString());
-		}
-
-		ProgramGlobals::pushVector(ret, adfsVecStr_);
-
-		return ret;
+		return evolution_.unpack(genome_);
 	}
 
-	SizeType length() const { return genes_.size() + adfsVecStr_.size(); }
+	const PackedGenome& genome() const { return genome_; }
+
+	SizeType length() const { return genes_.size() + adfsGenome_.size(); }
 
 	VectorStringType vecString(SizeType i) const
 	{
@@ -183,11 +166,13 @@ public:
 		return adfs_[index]->vecString();
 	}
 
-	const VectorStringType& effectiveVecString() const
+	VectorStringType effectiveVecString() const
 	{
-		return effectiveVecStr_;
+		return evolution_.unpack(effectiveGenome_);
 	}
 
+	const PackedGenome& effectiveGenome() const { return effectiveGenome_; }
+
 	ValueType exec(SizeType outputIndex) const
 	{
 		assert(genes_.size() > 0);
@@ -216,11 +201,52 @@ public:
 		return tmp;
 	}
 
-	SizeType effectiveSize() const { return effectiveVecStr_.size(); }
+	const TreeType& expression(SizeType i) const
+	{
+		assert(i < genes_.size());
+		return genes_[i]->getExpression();
+	}
+
+	const GeneType& gene(SizeType i) const
+	{
+		assert(i < genes_.size());
+		return *genes_[i];
+	}
+
+	SizeType effectiveSize() const { return effectiveGenome_.size(); }
 
 	SizeType size() const { return genes_.size(); }
 
-	PairVectorStringType recombine(const ChromosomeType& other,
+	SizeType adfs() const { return adfs_.size(); }
+
+	// Values of the defined constants, gene by gene
+	VectorValueType dcValues() const
+	{
+		VectorValueType values;
+		for (SizeType i = 0; i < genes_.size(); ++i)
+			genes_[i]->dcValues(values);
+		return values;
+	}
+
+	void setDcValues(const VectorValueType& values)
+	{
+		SizeType index = 0;
+		for (SizeType i = 0; i < genes_.size(); ++i)
+			genes_[i]->setDcValues(values, index);
+		assert(index == values.size());
+	}
+
+	PackedGenome genomeWithDcValues() const
+	{
+		PackedGenome ret;
+		for (SizeType i = 0; i < genes_.size(); ++i)
+			ret.append(genes_[i]->genomeWithDcValues());
+
+		ret.append(adfsGenome_);
+		return ret;
+	}
+
+	PairPackedGenomeType recombine(const ChromosomeType& other,
 	                               SizeType points) const
 	{
 		SizeType genes = genes_.size();
@@ -230,36 +256,36 @@ public:
 		bool isCell = (index >= genes);
 		SizeType indexCorrected = (isCell) ? genes_.size() : index;
 
-		VectorStringType firstVec;
+		PackedGenome firstVec;
 		for (SizeType i = 0; i < indexCorrected; i++) {
-			ProgramGlobals::pushVector(firstVec, genes_[i]->vecString());
+			firstVec.append(genes_[i]->genome());
 		}
 
-		VectorStringType lastVec;
+		PackedGenome lastVec;
 		if (!isCell) {
 			for (SizeType i = index+1; i < genes_.size(); i++) {
-				ProgramGlobals::pushVector(lastVec, genes_[i]->vecString());
+				lastVec.append(genes_[i]->genome());
 			}
 
-			ProgramGlobals::pushVector(lastVec, adfsVecStr_);
+			lastVec.append(adfsGenome_);
 		}
 
-		PairVectorStringType p = (points == 1) ?
-		            recombine1(gene->vecString(), other.vecString(index)) :
-		            recombine2(gene->vecString(), other.vecString(index));
+		PairPackedGenomeType p = (points == 1) ?
+		            recombine1(gene->genome(), other.geneGenome(index)) :
+		            recombine2(gene->genome(), other.geneGenome(index));
 
-		VectorStringType vecStr1 = firstVec;
-		ProgramGlobals::pushVector(vecStr1, p.first);
-		ProgramGlobals::pushVector(vecStr1, lastVec);
+		PackedGenome vecStr1 = firstVec;
+		vecStr1.append(p.first);
+		vecStr1.append(lastVec);
 
-		VectorStringType vecStr2 = firstVec;
-		ProgramGlobals::pushVector(vecStr2, p.second);
-		ProgramGlobals::pushVector(vecStr2, lastVec);
+		PackedGenome vecStr2 = firstVec;
+		vecStr2.append(p.second);
+		vecStr2.append(lastVec);
 
-		return PairVectorStringType(vecStr1, vecStr2);
+		return PairPackedGenomeType(vecStr1, vecStr2);
 	}
 
-	VectorStringType evolve(const PsimagLite::String& action) const
+	PackedGenome evolve(const PsimagLite::String& action) const
 	{
 		SizeType genes = genes_.size();
 		SizeType index = static_cast<SizeType>(evolution_.rng() * (genes+adfs_.size()));
@@ -267,38 +293,33 @@ public:
 		GeneType *gene = (index >= genes) ? adfs_[index - genes] : genes_[index];
 		bool isCell = (index >= genes);
 
-		VectorStringType firstVec;
+		PackedGenome firstVec;
 		for (SizeType i = 0; i < index; i++) {
-			ProgramGlobals::pushVector(firstVec, genes_[i]->vecString());
+			firstVec.append(genes_[i]->genome());
 		}
 
-		VectorStringType lastVec;
+		PackedGenome lastVec;
 
 		if (!isCell) {
 			for (SizeType i = index + 1; i < genes_.size(); ++i) {
-				ProgramGlobals::pushVector(lastVec, genes_[i]->vecString());
+				lastVec.append(genes_[i]->genome());
 			}
 
-			ProgramGlobals::pushVector(lastVec, adfsVecStr_);
+			lastVec.append(adfsGenome_);
 		}
 
-		VectorStringType ret = firstVec;
+		PackedGenome ret = firstVec;
 		if (action == "mutate") {
-			ProgramGlobals::pushVector(ret, evolution_.mutate(gene->vecString(),
-			                                                  gene->head(),
-			                                                  genes,
-			                                                  isCell));
-			ProgramGlobals::pushVector(ret, lastVec);
+			ret.append(evolution_.mutate(gene->genome(), gene->head(), genes, isCell));
+			ret.append(lastVec);
 			return ret;
 		} else if (action == "invert") {
-			ProgramGlobals::pushVector(ret, evolution_.invert(gene->vecString(),
-			                                                  gene->head()));
-			ProgramGlobals::pushVector(ret, lastVec);
+			ret.append(evolution_.invert(gene->genome(), gene->head()));
+			ret.append(lastVec);
 			return ret;
 		} else if (action == "swap") {
-			ProgramGlobals::pushVector(ret, swap(gene->vecString(),
-			                                     gene->head(),isCell));
-			ProgramGlobals::pushVector(ret, lastVec);
+			ret.append(swap(gene->genome(), gene->head(), isCell));
+			ret.append(lastVec);
 			return ret;
 		}
 
@@ -311,71 +332,70 @@ private:
 
 	Chromosome(const Chromosome&) = delete;
 
-	VectorStringType swap(const VectorStringType& str,
-	                      SizeType head,
-	                      bool isCell) const
+	const PackedGenome& geneGenome(SizeType i) const
 	{
-		VectorStringType ret = str;
+		if (i < genes_.size())
+			return genes_[i]->genome();
+
+		SizeType index = i - genes_.size();
+		assert(index < adfs_.size());
+		return adfs_[index]->genome();
+	}
+
+	PackedGenome swap(const PackedGenome& str,
+	                  SizeType head,
+	                  bool isCell) const
+	{
+		PackedGenome ret = str;
 		SizeType index = head;
 		while (index + 1 >= head) {
 			index = static_cast<SizeType>(evolution_.rng() * str.size());
 		}
 
-		ret[index] = str[index+1];
-		ret[index+1] = str[index];
+		ret.swapSymbols(index, index + 1);
 
-		if (isCell) evolution_.checkStringCell(ret, head, genes_.size());
-		else evolution_.checkStringNonCell(ret,head);
+		if (isCell) evolution_.checkGenomeCell(ret, head, genes_.size());
+		else evolution_.checkGenomeNonCell(ret,head);
 		return ret;
 	}
 
-	PairVectorStringType recombine1(const VectorStringType& str1,
-	                                const VectorStringType& str2) const
+	PairPackedGenomeType recombine1(const PackedGenome& str1,
+	                                const PackedGenome& str2) const
 	{
 		assert(str1.size() == str2.size());
 
 		SizeType len = str1.size();
 		SizeType index = static_cast<SizeType>(evolution_.rng() * len);
-		PairVectorStringType newVecStrings;
+		PairPackedGenomeType newVecStrings;
 		newVecStrings.first = recombine(str1, str2, index);
 		newVecStrings.second = recombine(str2, str1, index);
 		return newVecStrings;
 	}
 
-	VectorStringType recombine(const VectorStringType& str1,
-	                           const VectorStringType& str2,
-	                           SizeType index) const
+	PackedGenome recombine(const PackedGenome& str1,
+	                       const PackedGenome& str2,
+	                       SizeType index) const
 	{
-		VectorStringType ret(str2.size());
-		for (SizeType i = 0; i < index; ++i)
-			ret[i] = str1[i];
-
-		for (SizeType i = index; i < str2.size(); ++i)
-			ret[i] = str2[i];
-
+		PackedGenome ret;
+		ret.append(str1, 0, index);
+		ret.append(str2, index, str2.size());
 		return ret;
 	}
 
-	VectorStringType recombine(const VectorStringType& str1,
-	                           const VectorStringType& str2,
-	                           SizeType index1,
-	                           SizeType index2) const
+	PackedGenome recombine(const PackedGenome& str1,
+	                       const PackedGenome& str2,
+	                       SizeType index1,
+	                       SizeType index2) const
 	{
-		VectorStringType tmp1(str1.size());
-		for (SizeType i = 0; i < index1; ++i)
-			tmp1[i] = str1[i];
-
-		for (SizeType i = index1; i < index2; ++i)
-			tmp1[i] = str2[i];
-
-		for (SizeType i = index2; i < str1.size(); ++i)
-			tmp1[i] = str1[i];
-
+		PackedGenome tmp1;
+		tmp1.append(str1, 0, index1);
+		tmp1.append(str2, index1, index2);
+		tmp1.append(str1, index2, str1.size());
 		return tmp1;
 	}
 
-	PairVectorStringType recombine2(const VectorStringType& str1,
-	                                const VectorStringType& str2) const
+	PairPackedGenomeType recombine2(const PackedGenome& str1,
+	                                const PackedGenome& str2) const
 	{
 		assert(str1.size() == str2.size());
 
@@ -386,7 +406,7 @@ private:
 		SizeType index1 = (i1 < i2) ? i1 : i2;
 		SizeType index2 = (i1 < i2) ? i2 : i1;
 
-		PairVectorStringType newVecStrings;
+		PairPackedGenomeType newVecStrings;
 		newVecStrings.first = recombine(str1,str2,index1,index2);
 		assert(newVecStrings.first.size() == len);
 		newVecStrings.second = recombine(str2,str1,index1,index2);
@@ -396,8 +416,9 @@ private:
 
 	const EvolutionType& evolution_;
 	const ParametersType& params_;
-	VectorStringType effectiveVecStr_;
-	VectorStringType adfsVecStr_;
+	PackedGenome genome_;
+	PackedGenome effectiveGenome_;
+	PackedGenome adfsGenome_;
 	VectorGeneType genes_;
 	VectorGeneType adfs_;
 }; // class Fitness
@@ -44,9 +44,9 @@ public:
 	typedef typename PsimagLite::Vector<PsimagLite::String>::Type VectorStringType;
 	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
 	typedef typename PsimagLite::Vector<SizeType>::Type VectorSizeType;
-	typedef typename ChromosomeType::PairVectorStringType PairVectorStringType;
-	typedef typename ChromosomeType::PairVectorVectorStringType PairVectorVectorStringType;
-	typedef typename ChromosomeType::VectorVectorStringType VectorVectorStringType;
+	typedef typename ChromosomeType::PairPackedGenomeType PairPackedGenomeType;
+	typedef typename ChromosomeType::VectorPackedGenomeType VectorPackedGenomeType;
+	typedef std::pair<VectorPackedGenomeType, VectorPackedGenomeType> PairVectorPackedGenomeType;
 	typedef typename ChromosomeType::VectorAnglesType VectorAnglesType;
 	typedef PsimagLite::Vector<long unsigned int>::Type VectorLongUnsignedType;
 	typedef ParametersEngineType_ ParametersEngineType;
@@ -63,15 +63,14 @@ The engine constructor creates the initial individuals randomly.
 	{
 		constexpr SizeType threadNum = 0;
 		for (SizeType i = 0; i< params_.population; ++i) {
-			VectorStringType vecStr;
+			PackedGenome genome;
 			for (SizeType j = 0; j < params_.genes; ++j)
-				ProgramGlobals::pushVector(vecStr, evolution_.randomGene(params_.head));
+				genome.append(evolution_.randomGene(params_.head));
 			for (SizeType j = 0; j < params_.adfs; ++j)
-				ProgramGlobals::pushVector(vecStr, evolution_.randomAdf(params_.chead,
-				                                                        params_.genes));
+				genome.append(evolution_.randomAdf(params_.chead, params_.genes));
 			ChromosomeType* chromosome = new ChromosomeType(params_,
 			                                                evolution_,
-			                                                vecStr,
+			                                                genome,
 			                                                threadNum);
 			chromosomes_.push_back(chromosome);
 		}
@@ -92,15 +91,15 @@ fitness, where p is the population number set from the input file or the command
 	 */
 	bool evolve(SizeType ind)
 	{
-		PairVectorVectorStringType newChromosomes;
+		fitness_.startGeneration(ind);
+
+		PairVectorPackedGenomeType newChromosomes;
 		VectorRealType parentFitness(chromosomes_.size());
 		SizeType totalChromosomes = chromosomes_.size();
 		for (SizeType i = 0; i < totalChromosomes; i++) {
-			const VectorStringType vecStr = chromosomes_[i]->vecString();
-
-			const VectorStringType& effectiveVec = chromosomes_[i]->effectiveVecString();
+			const PackedGenome& effectiveVec = chromosomes_[i]->effectiveGenome();
 			if (notAdded(newChromosomes.second, effectiveVec)) {
-				newChromosomes.first.push_back(vecStr);
+				newChromosomes.first.push_back(chromosomes_[i]->genome());
 				newChromosomes.second.push_back(effectiveVec);
 			}
 		}
@@ -114,7 +113,19 @@ fitness, where p is the population number set from the input file or the command
 		parallelizer2.parallelFor(0,
 		                          totalChromosomes,
 		                          [&parentFitness, &seeds, this](SizeType ind, SizeType threadNum) {
-			parentFitness[ind] = -fitness_.getFitness(*chromosomes_[ind], seeds[ind], threadNum);
+			if (threadNum == 0) {
+				parentFitness[ind] = -fitness_.getFitness(*chromosomes_[ind],
+				                                          seeds[ind],
+				                                          threadNum);
+				return;
+			}
+
+			// parents were built with the nodes of thread 0
+			ChromosomeType chromosome(params_,
+			                          evolution_,
+			                          chromosomes_[ind]->genome(),
+			                          threadNum);
+			parentFitness[ind] = -fitness_.getFitness(chromosome, seeds[ind], threadNum);
 		});
 
 		evolution_.nodeFactory().sync();
@@ -137,12 +148,18 @@ fitness, where p is the population number set from the input file or the command
 
 private:
 
-	void canonicalizeAll(VectorVectorStringType& newChromosomes)
+	/* The canonical forms work on the string form, with the parameters written
+	   exactly; genomes are packed back only if their canonical form changed them,
+	   and nothing is unpacked if the canonical form does nothing */
+	void canonicalizeAll(VectorPackedGenomeType& newChromosomes)
 	{
+		if (CanonicalFormType::isEmpty) return;
+
 		for (SizeType i = 0; i < newChromosomes.size(); i++) {
-			CanonicalFormType canonicalForm(newChromosomes[i],
-			                                evolution_.nodeFactory());
-			canonicalForm.changeIfNeeded(newChromosomes[i]);
+			VectorStringType vecStr = evolution_.unpack(newChromosomes[i], true);
+			CanonicalFormType canonicalForm(vecStr, evolution_.nodeFactory());
+			if (canonicalForm.changeIfNeeded(vecStr))
+				newChromosomes[i] = evolution_.pack(vecStr);
 		}
 	}
 
@@ -153,26 +170,25 @@ private:
 		chromosomes_.clear();
 	}
 
-	void addWithCare(PairVectorVectorStringType& newChromosomes,
-	                 const VectorStringType& vecStr) const
+	void addWithCare(PairVectorPackedGenomeType& newChromosomes,
+	                 const PackedGenome& genome) const
 	{
 		constexpr SizeType threadNum = 0;
-		ChromosomeType chromosome(params_, evolution_, vecStr, threadNum);
-		VectorStringType vEff(chromosome.effectiveSize());
-		for (SizeType i = 0; i < chromosome.effectiveSize(); ++i)
-			vEff[i] = chromosome.vecString()[i];
+		ChromosomeType chromosome(params_, evolution_, genome, threadNum);
+		PackedGenome vEff;
+		vEff.append(chromosome.genome(), 0, chromosome.effectiveSize());
 		if (notAdded(newChromosomes.second, vEff))
-			newChromosomes.first.push_back(vecStr);
+			newChromosomes.first.push_back(genome);
 	}
 
-	void recombination(PairVectorVectorStringType& newChromosomes,
+	void recombination(PairVectorPackedGenomeType& newChromosomes,
 	                   const VectorRealType& parentFitness,
 	                   SizeType points) const
 	{
 		for (SizeType i = 0; i < params_.descendants; i++) {
 			SizeType index1 = selectAccordingToFitness(parentFitness);
 			SizeType index2 = selectAccordingToFitness(parentFitness);
-			PairVectorStringType newStrings = chromosomes_[index1]->
+			PairPackedGenomeType newStrings = chromosomes_[index1]->
 			        recombine(*chromosomes_[index2],
 			                  points);
 
@@ -213,19 +229,19 @@ private:
 		throw PsimagLite::RuntimeError("selectAccordingToFitness\n");
 	}
 
-	void evolve(PairVectorVectorStringType& newChromosomes,
+	void evolve(PairVectorPackedGenomeType& newChromosomes,
 	            const PsimagLite::String& action) const
 	{
 		SizeType population = chromosomes_.size();
 		for (SizeType i = 0; i < params_.mutation; i++) {
 			SizeType index = static_cast<SizeType>(fitness_.rng() * population);
-			VectorStringType newVecStr = chromosomes_[index]->evolve(action);
+			PackedGenome newGenome = chromosomes_[index]->evolve(action);
 
-			addWithCare(newChromosomes, newVecStr);
+			addWithCare(newChromosomes, newGenome);
 		}
 	}
 
-	bool selectBest(VectorVectorStringType& newChromosomes)
+	bool selectBest(VectorPackedGenomeType& newChromosomes)
 	{
 		assert(chromosomes_.size() > 0);
 		typename PsimagLite::Vector<RealType>::Type fitness(newChromosomes.size());
@@ -237,7 +253,126 @@ private:
 			throw PsimagLite::RuntimeError(errorMessage);
 		}
 
-		const SizeType totalChromosomes = newChromosomes.size();
+		SizeType population = chromosomes_.size();
+		RealType fraction = 0.8;
+		SizeType point = static_cast<SizeType>(population*fraction);
+
+		const RealType racingBudget = fitness_.racingBudget();
+		if (racingBudget > 0 && racingBudget < 1) {
+			race(fitness, newChromosomes, racingBudget, point);
+		} else {
+			VectorSizeType all(newChromosomes.size());
+			for (SizeType i = 0; i < all.size(); ++i)
+				all[i] = i;
+			computeFitness(fitness, newChromosomes, all);
+		}
+
+		sortByFitness(fitness, newChromosomes);
+
+		/* the individuals that can be selected, which are among the first population,
+		   are printed with their fitness at full fidelity; see FidelitySchedule.
+		   The others, with their fitness at lower fidelity, are dropped so that they
+		   do not compete with the former */
+		if (fitness_.fidelity() < 1) {
+			VectorSizeType first(std::min(population, newChromosomes.size()));
+			for (SizeType i = 0; i < first.size(); ++i)
+				first[i] = i;
+
+			fitness_.setFullFidelity(true);
+			computeFitness(fitness, newChromosomes, first);
+			fitness_.setFullFidelity(false);
+			newChromosomes.resize(first.size());
+			fitness.resize(first.size());
+			sortByFitness(fitness, newChromosomes);
+		}
+
+		deleteAll();
+
+		RealType maxFitness = params_.samples;
+		for (SizeType i = 0; i < point; i++) {
+			RealType f = -fitness[i];
+			addChromosome(newChromosomes[i], f);
+			if (i==0 && f == maxFitness) return true;
+		}
+
+		for (SizeType i = point; i < population; i++) {
+			SizeType index = point +
+			        static_cast<SizeType>(fitness_.rng() * population * (1.0-fraction));
+			assert(index >= point);
+			addChromosome(newChromosomes[index],-fitness[index]);
+		}
+
+		std::cout<<"----------------\n";
+		return false;
+	}
+
+	void sortByFitness(VectorRealType& fitness, VectorPackedGenomeType& newChromosomes) const
+	{
+		PsimagLite::Sort<typename PsimagLite::Vector<RealType>::Type> sort;
+		PsimagLite::Vector<SizeType>::Type iperm(fitness.size());
+		sort.sort(fitness,iperm);
+
+		VectorPackedGenomeType newChromosomes2 = newChromosomes;
+		for (SizeType i = 0; i < newChromosomes.size(); i++)
+			newChromosomes[i] = newChromosomes2[iperm[i]];
+
+		orderBySize(newChromosomes, fitness);
+	}
+
+	/* PSIDOC Engine::race
+With MinimizerRacing=$b$, for $0<b<1$, in the input file, Engine::selectBest
+races the new individuals by successive halving instead of minimizing the angles of
+each with the whole budget. In the first round every individual gets the fraction $b$
+of MinimizerMaxIterations; after each round, only the better half of those left, but no
+fewer than the individuals that the selection keeps by fitness, continues from the
+angles it has, for as many iterations again as it has had so far, so that the last
+round completes the budget of those that reach it. The individuals dropped keep the
+fitness of their last round. Most of the iterations thus go to the individuals that
+can make the cut of the selection.
+	 */
+	void race(VectorRealType& fitness,
+	          VectorPackedGenomeType& newChromosomes,
+	          RealType budget,
+	          SizeType keep)
+	{
+		VectorSizeType alive(newChromosomes.size());
+		for (SizeType i = 0; i < alive.size(); ++i)
+			alive[i] = i;
+
+		keep = std::max(keep, static_cast<SizeType>(1));
+		RealType spent = 0;
+		for (SizeType round = 0; ; ++round) {
+			fitness_.setRacingRound(round, budget);
+			computeFitness(fitness, newChromosomes, alive);
+			spent += budget;
+			if (spent >= 1 - 1e-6 || alive.size() <= 1) break;
+
+			// fitness holds minus the fitness, so the better come first
+			VectorRealType f(alive.size());
+			for (SizeType k = 0; k < alive.size(); ++k)
+				f[k] = fitness[alive[k]];
+
+			VectorSizeType iperm(f.size());
+			PsimagLite::Sort<VectorRealType> sort;
+			sort.sort(f, iperm);
+			VectorSizeType better(std::max(keep, (alive.size() + 1)/2));
+			better.resize(std::min(better.size(), alive.size()));
+			for (SizeType k = 0; k < better.size(); ++k)
+				better[k] = alive[iperm[k]];
+
+			budget = (better.size() <= keep) ? 1 - spent : std::min(spent, 1 - spent);
+			alive.swap(better);
+		}
+
+		fitness_.setRacingRound(0, 1);
+	}
+
+	// Computes the fitness of newChromosomes[i] for each i in indices
+	void computeFitness(VectorRealType& fitness,
+	                    VectorPackedGenomeType& newChromosomes,
+	                    const VectorSizeType& indices)
+	{
+		const SizeType totalChromosomes = indices.size();
 		PsimagLite::CodeSectionParams codeParams = PsimagLite::Concurrency::codeSectionParams;
 		codeParams.npthreads = std::min(totalChromosomes,
 		                       PsimagLite::Concurrency::codeSectionParams.npthreads);
@@ -254,15 +389,17 @@ private:
 		                          totalChromosomes,
 		                          [&newChromosomes,
 		                          &fitness,
+		                          &indices,
 		                          &seeds,
 		                          isVerbose,
 		                          withProgressBar,
-		                          this](SizeType ind, SizeType threadNum) {
+		                          this](SizeType i, SizeType threadNum) {
+			const SizeType ind = indices[i];
 			ChromosomeType chromosome(params_, evolution_, newChromosomes[ind], threadNum);
 			if (isVerbose)
-				std::cout<<"About to exec chromosome= "<<newChromosomes[ind]<<"\n";
-			fitness[ind] = -fitness_.getFitness(chromosome, seeds[ind], threadNum);
-			newChromosomes[ind] = chromosome.vecString();
+				std::cout<<"About to exec chromosome= "<<chromosome.vecString()<<"\n";
+			fitness[ind] = -fitness_.getFitness(chromosome, seeds[i], threadNum);
+			newChromosomes[ind] = chromosome.genome();
 			const int status = fitness_.status();
 			const PsimagLite::String symbol = (status == 0) ? "." : "*";
 			if (withProgressBar) std::cerr<<symbol;
@@ -271,47 +408,14 @@ private:
 		evolution_.nodeFactory().sync();
 
 		if (withProgressBar) std::cerr<<"\n";
-
-		PsimagLite::Sort<typename PsimagLite::Vector<RealType>::Type> sort;
-		PsimagLite::Vector<SizeType>::Type iperm(fitness.size());
-		sort.sort(fitness,iperm);
-
-		VectorVectorStringType newChromosomes2 = newChromosomes;
-		for (SizeType i = 0; i < newChromosomes.size(); i++)
-			newChromosomes[i] = newChromosomes2[iperm[i]];
-
-		orderBySize(newChromosomes, fitness);
-
-		SizeType population = chromosomes_.size();
-		RealType fraction = 0.8;
-		SizeType point = static_cast<SizeType>(population*fraction);
-
-		deleteAll();
-
-		RealType maxFitness = params_.samples;
-		for (SizeType i = 0; i < point; i++) {
-			RealType f = -fitness[i];
-			addChromosome(newChromosomes[i], f);
-			if (i==0 && f == maxFitness) return true;
-		}
-
-		for (SizeType i = point; i < population; i++) {
-			SizeType index = point +
-			        static_cast<SizeType>(fitness_.rng() * population * (1.0-fraction));
-			assert(index >= point);
-			addChromosome(newChromosomes[index],-fitness[index]);
-		}
-
-		std::cout<<"----------------\n";
-		return false;
 	}
 
-	void addChromosome(const VectorStringType& str, const RealType& f)
+	void addChromosome(const PackedGenome& genome, const RealType& f)
 	{
 		constexpr SizeType threadNum = 0;
 		ChromosomeType* chromosome = new ChromosomeType(params_,
 		                                                evolution_,
-		                                                str,
+		                                                genome,
 		                                                threadNum);
 
 		assert(chromosome);
@@ -325,8 +429,8 @@ private:
 		std::cout<<esize<<chromosome->effectiveSize()<<"\n";
 	}
 
-	bool notAdded(const VectorVectorStringType& newChromosomes,
-	              const VectorStringType& newStr) const
+	bool notAdded(const VectorPackedGenomeType& newChromosomes,
+	              const PackedGenome& newStr) const
 	{
 		return (find(newChromosomes.begin(),
 		             newChromosomes.end(),
@@ -381,7 +485,7 @@ private:
 		return max;
 	}
 
-	void orderBySize(VectorVectorStringType& newChromosomes,const VectorRealType& fitness) const
+	void orderBySize(VectorPackedGenomeType& newChromosomes,const VectorRealType& fitness) const
 	{
 		constexpr SizeType threadNum = 0;
 		RealType value = -fitness_.maxFitness();
@@ -399,7 +503,7 @@ private:
 		PsimagLite::Sort<typename PsimagLite::Vector<RealType>::Type> sort;
 		sort.sort(bestSize,iperm);
 
-		VectorVectorStringType oldChromosomes = newChromosomes;
+		VectorPackedGenomeType oldChromosomes = newChromosomes;
 		for (SizeType i = 0; i < fitness.size(); i++) {
 			if (fitness[i] != value) break;
 			newChromosomes[i] = oldChromosomes[iperm[i]];
@@ -21,6 +21,8 @@ along with evendim. If not, see <http://www.gnu.org/licenses/>.
 #include "Vector.h"
 #include <cassert>
 #include <iostream>
+#include <sstream>
+#include <limits>
 #include "TypeToString.h"
 #include "PsimagLite.h"
 #include "ProgramGlobals.h"
@@ -42,14 +44,20 @@ public:
 	typedef PrimitivesType_ PrimitivesType;
 	typedef NodeFactory<NodeType> NodeFactoryType;
 	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
+	typedef PackedGenome::ParamType AngleType;
 
+	/* With dcTerminal, the defined constant ? is also a terminal, so that
+	   each of its leaves can get its own value, as with -o tuneConstants */
 	Evolution(PrimitivesType& primitives,
 	          SizeType r,
-	          bool verbose)
+	          bool verbose,
+	          bool dcTerminal = false)
 	    : primitives_(primitives),
 	      verbose_(verbose),
+	      dcTerminal_(dcTerminal),
 	      maxArity_(0),
-	      nodeFactory_(primitives.nodesSerial()),
+	      nodeFactory_(primitives.nodesSerial(), primitives.dcArray()),
+	      angleGrid_(primitives.angleGrid()),
 	      rng_(r)
 	{
 		maxArity_ = maxArity();
@@ -64,117 +72,149 @@ public:
 		return head*(maxArity_ - 1) + 1;
 	}
 
-	VectorStringType randomGene(SizeType head) const
+	PackedGenome randomGene(SizeType head) const
 	{
 		const SizeType tail1 = tail(head);
-		VectorStringType str = nonTerminals_;
-		ProgramGlobals::pushVector(str, terminals_);
-		VectorStringType str1 = selectRandomFrom(head,str);
-		const VectorStringType str2 = selectRandomFrom(tail1, terminals_);
+		VectorSizeType str = nonTerminals_;
+		ProgramGlobals::pushVector<SizeType>(str, terminals_);
+		PackedGenome genome;
+		selectRandomFrom(genome, head, str);
+		selectRandomFrom(genome, tail1, terminals_);
 		bool hasDc = (primitives_.dcValues().size() > 0);
 		const SizeType dc = (hasDc) ? tail1 : 0;
-		const VectorStringType str3 = selectRandomFrom(dc, primitives_.dcArray());
-		ProgramGlobals::pushVector(str1, str2);
-		ProgramGlobals::pushVector(str1, str3);
-		return str1;
+		selectRandomFrom(genome, dc, dcArray_);
+		return genome;
 	}
 
-	VectorStringType randomAdf(SizeType chead,SizeType genes) const
+	PackedGenome randomAdf(SizeType chead,SizeType genes) const
 	{
-		VectorStringType terminals(genes);
-		for (SizeType i = 0; i < genes; i++)
-			terminals[i] = ttos(i);
+		const VectorSizeType terminals = cellTerminals(genes);
 		SizeType ctail = tail(chead);
-		VectorStringType str = nonTerminals_;
-		ProgramGlobals::pushVector(str, terminals);
-		VectorStringType str1 = selectRandomFrom(chead, str);
-		const VectorStringType str2 = selectRandomFrom(ctail, terminals);
-		ProgramGlobals::pushVector(str1, str2);
-		return str1;
+		VectorSizeType str = nonTerminals_;
+		ProgramGlobals::pushVector<SizeType>(str, terminals);
+		PackedGenome genome;
+		selectRandomFrom(genome, chead, str);
+		selectRandomFrom(genome, ctail, terminals);
+		return genome;
 	}
 
 	const PrimitivesType& primitives() const { return primitives_; }
 
-	VectorStringType mutate(const VectorStringType& str,
-	                        SizeType head,
-	                        SizeType genes,
-	                        bool isCell) const
+	// Strings are only used for input and output; see PackedGenome
+	PackedGenome pack(const VectorStringType& vecStr) const
 	{
-		SizeType len = str.size();
+		PackedGenome genome;
+		const SizeType n = vecStr.size();
+		for (SizeType i = 0; i < n; ++i) {
+			const PsimagLite::String& str = vecStr[i];
+			genome.push(nodeFactory_.opcode(str));
+			const long unsigned int colon = str.find(':');
+			if (colon != PsimagLite::String::npos)
+				genome.setParam(i, PsimagLite::atof(str.substr(colon + 1)));
+		}
 
-		SizeType index = static_cast<SizeType>(rng_() * len);
+		return genome;
+	}
+
+	/* With exact, parameters are written with all their digits, so that pack()
+	   gives them back unchanged; otherwise as printed */
+	VectorStringType unpack(const PackedGenome& genome, bool exact = false) const
+	{
+		const SizeType n = genome.size();
+		VectorStringType vecStr(n);
+		for (SizeType i = 0; i < n; ++i) {
+			vecStr[i] = nodeFactory_.symbol(genome.opcode(i));
+			if (!genome.hasParam(i)) continue;
 
-		VectorStringType something = getStringForRegion(index, head, genes, isCell);
+			const AngleType param = genome.param(i);
+			vecStr[i] += ":" + ((exact) ? exactString(param) : ttos(param));
+		}
 
-		VectorStringType ret(index);
-		for (SizeType i = 0; i < index; ++i)
-			ret[i] = str[i];
+		return vecStr;
+	}
 
-		VectorStringType vRandom = selectRandomFrom(1, something);
-		ProgramGlobals::pushVector(ret, vRandom);
+	PackedGenome mutate(const PackedGenome& genome,
+	                    SizeType head,
+	                    SizeType genes,
+	                    bool isCell) const
+	{
+		SizeType len = genome.size();
 
-		for (SizeType i = index + 1; i < str.size(); ++i)
-			ret.push_back(str[i]);
+		SizeType index = static_cast<SizeType>(rng_() * len);
 
+		// on a grid, half of the mutations of a gate with an angle move the angle
+		if (angleGrid_ > 0 && hasAngle_[genome.opcode(index)] && rng_() < 0.5) {
+			PackedGenome ret = genome;
+			const SizeType j = (genome.hasParam(index)) ? gridIndex(genome.param(index))
+			                                            : randomGridIndex();
+			const SizeType step = (rng_() < 0.5) ? 1 : angleGrid_ - 1;
+			ret.setParam(index, gridAngle((j + step) % angleGrid_));
+			return ret;
+		}
+
+		VectorSizeType something = getOpcodesForRegion(index, head, genes, isCell);
+
+		PackedGenome ret;
+		ret.append(genome, 0, index);
+		selectRandomFrom(ret, 1, something);
+		ret.append(genome, index + 1, len);
 		return ret;
 	}
 
-	VectorStringType getStringForRegion(SizeType index,
-	                                    SizeType head,
-	                                    SizeType genes,
-	                                    bool isCell) const
+	VectorSizeType getOpcodesForRegion(SizeType index,
+	                                   SizeType head,
+	                                   SizeType genes,
+	                                   bool isCell) const
 	{
 		if (isCell)
-			return getStringForRegionCell(index,head,genes);
+			return getOpcodesForRegionCell(index,head,genes);
 		else
-			return getStringForRegionNonCell(index,head);
+			return getOpcodesForRegionNonCell(index,head);
 	}
 
-	VectorStringType getStringForRegionNonCell(SizeType index,
-	                                           SizeType head) const
+	VectorSizeType getOpcodesForRegionNonCell(SizeType index,
+	                                          SizeType head) const
 	{
 		SizeType tail1 = tail(head);
 		if (index < head) {
-			VectorStringType ret = terminals_;
-			ProgramGlobals::pushVector(ret, nonTerminals_);
+			VectorSizeType ret = terminals_;
+			ProgramGlobals::pushVector<SizeType>(ret, nonTerminals_);
 			return ret;
 		}
 
 		if (index < head + tail1)
 			return terminals_;
 
-		return primitives_.dcArray();
+		return dcArray_;
 	}
 
-	VectorStringType getStringForRegionCell(SizeType index,
-	                                        SizeType head,
-	                                        SizeType genes) const
+	VectorSizeType getOpcodesForRegionCell(SizeType index,
+	                                       SizeType head,
+	                                       SizeType genes) const
 	{
 
-		VectorStringType terminals(genes);
-		for (SizeType i = 0; i < genes; ++i)
-			terminals[i] = ttos(i);
+		VectorSizeType terminals = cellTerminals(genes);
 
 		if (index < head)
-			ProgramGlobals::pushVector(terminals, nonTerminals_);
+			ProgramGlobals::pushVector<SizeType>(terminals, nonTerminals_);
 
 		return terminals;
 	}
 
-	VectorStringType invert(const VectorStringType& str,SizeType head) const
+	PackedGenome invert(const PackedGenome& genome, SizeType head) const
 	{
-		VectorStringType ret = str;
+		PackedGenome ret = genome;
 		for (SizeType i = 0; i < head; ++i)
-			ret[i] = str[head - i - 1];
+			ret.copy(i, genome, head - i - 1);
 
 		return ret;
 	}
 
-	void checkStringNonCell(const VectorStringType& vecStr,
+	void checkGenomeNonCell(const PackedGenome& genome,
 	                        SizeType head) const
 	{
 		SizeType tail1 = tail(head);
-		SizeType len = vecStr.size();
+		SizeType len = genome.size();
 		bool hasDc = (primitives_.dcValues().size() > 0);
 		SizeType dc = (hasDc)? tail(head) : 0;
 
@@ -186,42 +226,33 @@ public:
 			err(errorMessage);
 		}
 
-		VectorStringType terminals = terminals_;
-
 		for (SizeType i = head; i < len -dc; i++) {
-			if (std::find(terminals.begin(),terminals.end(), vecStr[i]) != terminals.end())
+			if (std::find(terminals_.begin(), terminals_.end(), genome.opcode(i)) !=
+			        terminals_.end())
 				continue;
 			PsimagLite::String errorMessage(__FILE__);
 			errorMessage += " " + ttos(__LINE__) + "\n";
 			errorMessage += "head= " + ttos(head);
-			errorMessage += " string " + ProgramGlobals::vecStrToStr(vecStr, "") + "\n";
+			errorMessage += " string " + ProgramGlobals::vecStrToStr(unpack(genome), "") + "\n";
 			throw PsimagLite::RuntimeError(errorMessage);
 		}
 
 		for (SizeType i = head + tail1; i < len; ++i) {
-			PsimagLite::String cStr = vecStr[i];
-			if (cStr.size() != 1) {
-				PsimagLite::String errorMessage(__FILE__);
-				errorMessage += " " + ttos(__LINE__) + "\n";
-				err(errorMessage);
-			}
-
-			const char c = cStr[0];
-			SizeType x = c - 48;
-			if (x >= primitives_.dcArray().size()) {
-				PsimagLite::String errorMessage(__FILE__);
-				errorMessage += " " + ttos(__LINE__) + "\n";
-				err(errorMessage);
-			}
+			if (std::find(dcArray_.begin(), dcArray_.end(), genome.opcode(i)) !=
+			        dcArray_.end() && !genome.hasParam(i))
+				continue;
+			PsimagLite::String errorMessage(__FILE__);
+			errorMessage += " " + ttos(__LINE__) + "\n";
+			err(errorMessage);
 		}
 	}
 
-	void checkStringCell(const VectorStringType& str,
+	void checkGenomeCell(const PackedGenome& genome,
 	                     SizeType head,
 	                     SizeType genes) const
 	{
 		SizeType tail1 = tail(head);
-		SizeType len = str.size();
+		SizeType len = genome.size();
 
 		if (len != head + tail1) {
 			PsimagLite::String errorMessage(__FILE__);
@@ -231,17 +262,16 @@ public:
 			throw PsimagLite::RuntimeError(errorMessage);
 		}
 
-		VectorStringType terminals(genes);
-		for (SizeType i = 0; i < genes; ++i)
-			terminals[i] = ttos(i);
+		const VectorSizeType terminals = cellTerminals(genes);
 
 		for (SizeType i = head; i < len; i++) {
-			if (std::find(terminals.begin(), terminals.end(), str[i]) != terminals.end())
+			if (std::find(terminals.begin(), terminals.end(), genome.opcode(i)) !=
+			        terminals.end() && !genome.hasParam(i))
 				continue;
 			PsimagLite::String errorMessage(__FILE__);
 			errorMessage += " " + ttos(__LINE__) + "\n";
 			errorMessage += "head= " + ttos(head);
-			errorMessage += " string " + ProgramGlobals::vecStrToStr(str, "") + "\n";
+			errorMessage += " string " + ProgramGlobals::vecStrToStr(unpack(genome), "") + "\n";
 			err(errorMessage);
 		}
 	}
@@ -252,6 +282,16 @@ public:
 
 	double rng() const { return rng_(); }
 
+	// The number of angles of the grid, or 0 for continuous angles; see AngleGrid
+	SizeType angleGrid() const { return angleGrid_; }
+
+	// The angle of the grid nearest to angle
+	AngleType nearestGridAngle(AngleType angle) const
+	{
+		assert(angleGrid_ > 0);
+		return gridAngle(gridIndex(angle));
+	}
+
 	SizeType numberOfInputs() const { return inputs_.size(); }
 
 	void setInput(SizeType ind, ValueType x, SizeType threadNum)
@@ -261,23 +301,21 @@ public:
 		return nodeFactory_.node(inputs_[ind], threadNum).set(x);
 	}
 
-	void setInput(const VectorValueType& x) const
+	void setInput(const VectorValueType& x, SizeType threadNum = 0) const
 	{
 		assert(x.size() == inputs_.size());
 		SizeType n = std::min(x.size(), inputs_.size());
 		assert(n > 0);
 		assert(n < nodeFactory_.numberOfNodes() + 1);
-		const SizeType threadNum = 0;
 		for (SizeType i = 0; i < n; ++i) {
 			nodeFactory_.node(inputs_[i], threadNum).set(x[i]);
 		}
 	}
 
-	void printInputs(std::ostream& os) const
+	void printInputs(std::ostream& os, SizeType threadNum = 0) const
 	{
 		assert(nodeFactory_.numberOfNodes() > 0);
 
-		const SizeType threadNum = 0;
 		os<<"inputs= ";
 		for (SizeType i = 0; i < inputs_.size(); i++) {
 			SizeType j = inputs_[i];
@@ -289,16 +327,46 @@ public:
 
 private:
 
-	VectorStringType selectRandomFrom(SizeType head, const VectorStringType& str) const
+	void selectRandomFrom(PackedGenome& genome,
+	                      SizeType head,
+	                      const VectorSizeType& opcodes) const
 	{
-		VectorStringType ret(head);
-
 		for (SizeType i = 0; i < head; i++) {
-			SizeType index = static_cast<SizeType>(rng_()*str.size());
-			ret[i] = str[index];
+			SizeType index = static_cast<SizeType>(rng_()*opcodes.size());
+			genome.push(opcodes[index]);
+			if (angleGrid_ > 0 && hasAngle_[opcodes[index]])
+				genome.setParam(genome.size() - 1, gridAngle(randomGridIndex()));
 		}
+	}
 
-		return ret;
+	static PsimagLite::String exactString(AngleType value)
+	{
+		std::ostringstream os;
+		os.precision(std::numeric_limits<AngleType>::max_digits10);
+		os<<value;
+		return os.str();
+	}
+
+	AngleType gridAngle(SizeType j) const { return 2*M_PI*j/angleGrid_; }
+
+	SizeType gridIndex(AngleType angle) const
+	{
+		const long int j = lround(angle*angleGrid_/(2*M_PI)) % static_cast<long int>(angleGrid_);
+		return (j < 0) ? j + angleGrid_ : j;
+	}
+
+	SizeType randomGridIndex() const
+	{
+		return std::min(static_cast<SizeType>(rng_()*angleGrid_), angleGrid_ - 1);
+	}
+
+	// The terminals of the ADFs are the outputs of the genes
+	VectorSizeType cellTerminals(SizeType genes) const
+	{
+		VectorSizeType terminals(genes);
+		for (SizeType i = 0; i < genes; i++)
+			terminals[i] = nodeFactory_.opcode(ttos(i));
+		return terminals;
 	}
 
 	SizeType maxArity() const
@@ -316,24 +384,40 @@ private:
 	void setInputsTerminalsAndNonTerminals()
 	{
 		SizeType threadNum = 0;
+		// indexed by opcode
+		const SizeType codes = nodeFactory_.numberOfCodes();
+		hasAngle_.resize(codes, false);
+		for (SizeType op = 0; op < codes; ++op)
+			hasAngle_[op] = NodeFactoryType::hasAngle(nodeFactory_.symbol(op));
+
 		for (SizeType i = 0; i < nodeFactory_.numberOfNodes(); ++i) {
+			const PsimagLite::String code = nodeFactory_.node(i, threadNum).code();
 			if (nodeFactory_.node(i, threadNum).isInput()) {
 				inputs_.push_back(i);
-				terminals_.push_back(nodeFactory_.node(i, threadNum).code());
-			} else if (nodeFactory_.node(i, threadNum).arity()>0 &&
-			           nodeFactory_.node(i, threadNum).code()[0] != '_') {
-				nonTerminals_.push_back(nodeFactory_.node(i, threadNum).code());
+				terminals_.push_back(nodeFactory_.opcode(code));
+			} else if (nodeFactory_.node(i, threadNum).arity()>0 && code[0] != '_') {
+				nonTerminals_.push_back(nodeFactory_.opcode(code));
+			} else if (code == "?" && dcTerminal_) {
+				terminals_.push_back(nodeFactory_.opcode(code)); // defined constant
 			}
 		}
+
+		const VectorStringType& dcArray = primitives_.dcArray();
+		for (SizeType i = 0; i < dcArray.size(); ++i)
+			dcArray_.push_back(nodeFactory_.opcode(dcArray[i]));
 	}
 
 	PrimitivesType& primitives_;
 	bool verbose_;
+	bool dcTerminal_;
 	SizeType maxArity_;
 	NodeFactoryType nodeFactory_;
 	VectorSizeType inputs_;
-	VectorStringType nonTerminals_;
-	VectorStringType terminals_;
+	VectorSizeType nonTerminals_;
+	VectorSizeType terminals_;
+	VectorSizeType dcArray_;
+	SizeType angleGrid_;
+	PsimagLite::Vector<bool>::Type hasAngle_;
 	mutable PsimagLite::MersenneTwister rng_; //RandomForTests<double> rng_;
 }; // class Evolution
 
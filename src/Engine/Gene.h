@@ -22,6 +22,7 @@ along with evendim. If not, see <http://www.gnu.org/licenses/>.
 #include "TypeToString.h"
 #include "PsimagLite.h"
 #include "ProgramGlobals.h"
+#include "PackedGenome.h"
 
 namespace Gep {
 
@@ -38,31 +39,36 @@ public:
 	typedef Gene<TreeType,EvolutionType> GeneType;
 
 	Gene(const Gene& other)
-	    : head_ (other.head_),
+	    : evolution_(other.evolution_),
+	      head_ (other.head_),
 	      tail_(other.tail_),
-	      vecStr_(other.vecStr_),
+	      genome_(other.genome_),
 	      vt_(other.vt_.size(), nullptr)
 	{
 		const SizeType  n = vt_.size();
 		for (SizeType i = 0; i < n; ++i) {
 			vt_[i] = new TreeType(*other.vt_[i]);
+			vt_[i]->clearDescendants();
 		}
+
+		link(vt_);
 	}
 
 	Gene(SizeType head,
 	     bool isCell,
 	     const EvolutionType& evolution,
-	     const VectorStringType& vecStr,
+	     const PackedGenome& genome,
 	     SizeType threadNum)
-	    : head_(head),
+	    : evolution_(evolution),
+	      head_(head),
 	      tail_(evolution.tail(head)),
-	      vecStr_(vecStr)
+	      genome_(genome)
 	{
-		if (!isCell) evolution.checkStringNonCell(vecStr_, head);
+		if (!isCell) evolution.checkGenomeNonCell(genome_, head);
 
 		SizeType headPlusTail = head_ + tail_;
 
-		fromString(vt_, evolution, vecStr, headPlusTail, isCell, threadNum);
+		fromGenome(vt_, evolution, genome, headPlusTail, isCell, threadNum);
 	}
 
 	~Gene()
@@ -70,38 +76,35 @@ public:
 		deleteAll();
 	}
 
-	static void fromString(VectorTreeType& vt,
+	static void fromGenome(VectorTreeType& vt,
 	                       const EvolutionType& evolution,
-	                       const VectorStringType& vecStr,
+	                       const PackedGenome& genome,
 	                       SizeType effectiveSize,
 	                       bool isCell,
 	                       SizeType threadNum)
 	{
-		PsimagLite::Vector<SizeType>::Type va;
-		const SizeType dcLength = vecStr.size() - effectiveSize;
+		const SizeType dcLength = genome.size() - effectiveSize;
 		SizeType sumOfA = 1;
 		SizeType dcIndex = 0;
-		PsimagLite::String dcStr = (dcLength > 0) ? vecStr[dcIndex + effectiveSize] : "0";
-		assert(dcStr.length() == 1 and dcStr[0] >= 48);
-		SizeType dcNumber = dcStr[0] - 48;
 		const VectorValueType& dcArray = evolution.primitives().dcValues();
-		assert(dcLength == 0 || dcNumber < dcArray.size());
-		ValueType dcValue = (dcLength > 0) ? dcArray[dcNumber] : ValueType(0);
+		ValueType dcValue = (dcLength > 0) ? dcArray[dcNumber(evolution, genome, effectiveSize)]
+		                                   : ValueType(0);
 
 		for (SizeType i = 0; i < effectiveSize; i++) {
-			PsimagLite::String cStr = vecStr[i];
-			const NodeType& node = evolution.nodeFactory().findNodeFromCode(cStr,
-			                                                                dcValue,
-			                                                                isCell,
-			                                                                threadNum);
-			if (cStr == "?") {
+			const NodeType& node = evolution.nodeFactory().findNodeFromGenome(genome,
+			                                                                  i,
+			                                                                  dcValue,
+			                                                                  isCell,
+			                                                                  threadNum);
+			const bool isDc = (node.code() == "?");
+			ValueType thisDcValue = dcValue;
+			if (isDc && genome.hasParam(i)) readDcValue(thisDcValue, genome.param(i));
+
+			if (isDc) {
 				assert(dcLength > 0);
 				dcIndex++;
 				assert(dcIndex < dcLength);
-				dcStr = vecStr[dcIndex + effectiveSize];
-				dcNumber = dcStr[0] - 48;
-				assert(dcNumber < dcArray.size());
-				dcValue = dcArray[dcNumber];
+				dcValue = dcArray[dcNumber(evolution, genome, dcIndex + effectiveSize)];
 			}
 
 			SizeType a = node.arity();
@@ -109,16 +112,75 @@ public:
 			TreeType* tree = new TreeType(evolution.primitives(),
 			                              node,
 			                              evolution.verbose());
+			if (isDc) tree->setDcValue(thisDcValue);
 
-			va.push_back(a);
 			vt.push_back(tree);
 			if (sumOfA == 0) break;
 		}
 
+		link(vt);
+	}
+
+	VectorStringType vecString() const
+	{
+		return evolution_.unpack(genome_);
+	}
+
+	const PackedGenome& genome() const { return genome_; }
+
+	const TreeType& getExpression() const
+	{
+		return *vt_[0];
+	}
+
+	const SizeType head() const { return head_; }
+
+	SizeType effectiveSize() const
+	{
+		return vt_.size();
+	}
+
+	// Appends the values of the defined constants, in the order of the genome
+	void dcValues(VectorValueType& values) const
+	{
+		for (SizeType i = 0; i < vt_.size(); ++i)
+			if (vt_[i]->isDc()) values.push_back(vt_[i]->dcValue());
+	}
+
+	void setDcValues(const VectorValueType& values, SizeType& index)
+	{
+		for (SizeType i = 0; i < vt_.size(); ++i) {
+			if (!vt_[i]->isDc()) continue;
+			assert(index < values.size());
+			vt_[i]->setDcValue(values[index++]);
+		}
+	}
+
+	// The genome with the value of each defined constant as its parameter
+	PackedGenome genomeWithDcValues() const
+	{
+		PackedGenome ret = genome_;
+		for (SizeType i = 0; i < vt_.size(); ++i)
+			if (vt_[i]->isDc()) ret.setParam(i, dcToParam(vt_[i]->dcValue()));
+		return ret;
+	}
+
+	// The tree of symbol i of the effective part
+	const TreeType& tree(SizeType i) const
+	{
+		assert(i < vt_.size());
+		return *vt_[i];
+	}
+
+private:
+
+	// Sets the descendants of each tree, in the order of the genome
+	static void link(VectorTreeType& vt)
+	{
 		SizeType k = 0;
 		for (SizeType i = 0; i < vt.size(); i++) {
-			SizeType a = va[i];
-			if (a == 0 || !vt[i]) continue;
+			SizeType a = vt[i]->node().arity();
+			if (a == 0) continue;
 			for (SizeType j = k+1; j < k+a+1; j++) {
 				if (j>=vt.size()) continue;
 				vt[i]->setDescendants(*vt[j]);
@@ -128,24 +190,37 @@ public:
 		}
 	}
 
-	const VectorStringType& vecString() const
+	// The index in dcValues of the symbol i of the dc domain of genome
+	static SizeType dcNumber(const EvolutionType& evolution,
+	                         const PackedGenome& genome,
+	                         SizeType i)
 	{
-		return vecStr_;
+		const PsimagLite::String& dcStr = evolution.nodeFactory().symbol(genome.opcode(i));
+		assert(dcStr.length() == 1 and dcStr[0] >= 48);
+		const SizeType number = dcStr[0] - 48;
+		assert(number < evolution.primitives().dcValues().size());
+		return number;
 	}
 
-	const TreeType& getExpression() const
+	static void readDcValue(double& value, PackedGenome::ParamType param)
 	{
-		return *vt_[0];
+		value = param;
 	}
 
-	const SizeType head() const { return head_; }
-
-	SizeType effectiveSize() const
+	template<typename SomeValueType>
+	static void readDcValue(SomeValueType&, PackedGenome::ParamType)
 	{
-		return vt_.size();
+		err("Gene: defined constants with values need a real ValueType\n");
 	}
 
-private:
+	static PackedGenome::ParamType dcToParam(double value) { return value; }
+
+	template<typename SomeValueType>
+	static PackedGenome::ParamType dcToParam(const SomeValueType&)
+	{
+		err("Gene: defined constants with values need a real ValueType\n");
+		return 0;
+	}
 
 	Gene& operator=(const Gene& other) = delete;
 
@@ -157,9 +232,10 @@ private:
 		}
 	}
 
+	const EvolutionType& evolution_;
 	SizeType head_;
 	SizeType tail_;
-	VectorStringType vecStr_;
+	PackedGenome genome_;
 	VectorTreeType vt_;
 }; // class Gene
 
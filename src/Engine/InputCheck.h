@@ -16,20 +16,37 @@ public:
 		str += "integer Population;\n";
 		str += "integer Generations;\n";
 		str += "integer NumberOfBits;\n";
+		str += "integer RngSeed;\n";
+		str += "integer AngleGrid;\n";
 		str += "integer Samples;\n";
 		str += "integer MinimizerVerbose;\n";
+		str += "integer MinimizerMemory;\n";
+		str += "integer MinimizerWarmStart;\n";
+		str += "integer MinimizerThreads;\n";
+		str += "integer MinimizerStarts;\n";
+		str += "integer MinimizerInheritAngles;\n";
+		str += "integer MinimizerFidelityGenerations;\n";
 		str += "integer ProgressBar;\n";
 		str += "integer HamiltonianIsPeriodic;\n";
+		str += "integer HamiltonianMatrixFree;\n";
+		str += "integer HamiltonianPrintGroundState;\n";
+		str += "string HamiltonianGroundStateFile;\n";
+		str += "integer HamiltonianThreads;\n";
+		str += "integer HamiltonianHermitian;\n";
+		str += "integer HamiltonianReducedBasis;\n";
 
 		str += "string Primitives;\n";
 		str += "string MinimizerAlgorithm;\n";
 		str += "string RunType;\n";
 		str += "string Hamiltonian;\n";
 		str += "string InVectorFile;\n";
+		str += "string SymmetrySector;\n";
 
 		str += "real MinimizerTolerance;\n";
 		str += "real MinimizerDelta;\n";
 		str += "real MinimizerDelta2;\n";
+		str += "real MinimizerRacing;\n";
+		str += "real MinimizerFidelity;\n";
 		str += "real HamiltonianCoupling;\n";
 		str += "string GraphFile;\n";
 		str += "integer Threads;\n";
@@ -6,6 +6,38 @@
 
 namespace Gep {
 
+/* PSIDOC MinimizerParams
+The angles of the gates of each quantum circuit are found by minimization,
+configured by the following optional lines of the input file.
+\begin{itemize}
+\item[MinimizerAlgorithm] Simplex, ConjugateGradient, LBFGS, Rotosolve, CMAES, or None.
+Defaults to ConjugateGradient.
+\item[MinimizerMaxIterations] The maximum number of iterations, or of sweeps for Rotosolve.
+Defaults to 100.
+\item[MinimizerTolerance] The tolerance for convergence. Defaults to $10^{-3}$.
+\item[MinimizerDelta] The initial step. Defaults to 0.1.
+\item[MinimizerDelta2] The tolerance of the line search of ConjugateGradient. Defaults to 0.1.
+\item[MinimizerSaveEvery] Used by ConjugateGradient only. Defaults to 0.
+\item[MinimizerMemory] The number of curvature pairs kept by LBFGS. Defaults to 6.
+\item[MinimizerWarmStart] If 1, LBFGS starts from curvature pairs of the previous
+generation; see below. Defaults to 0.
+\item[MinimizerInheritAngles] If 1, the genome keeps the angles found even if
+the minimizer did not converge; see below. Defaults to 0.
+\item[MinimizerStarts] The number of starting points of each minimization, which
+race as described below. Defaults to 1.
+\item[MinimizerRacing] If between 0 and 1, the fraction of MinimizerMaxIterations that
+each new individual gets in the first round of a race; see Engine::selectBest.
+Defaults to 0, which disables racing.
+\item[MinimizerFidelity] If between 0 and 1, the fraction of MinimizerMaxIterations of
+the minimizations of the first generation, which rises to 1 as described below. Defaults to 1.
+\item[MinimizerFidelityGenerations] The number of steps in which the fidelity
+rises to 1. Defaults to 10.
+\item[MinimizerThreads] The number of threads with which CMAES evaluates each batch
+of angles. Only used with Threads=1, as otherwise the individuals are already
+evaluated in parallel. Defaults to 1.
+\item[MinimizerVerbose] If 1, the minimizer is verbose. Defaults to 0.
+\end{itemize}
+*/
 template<typename RealType_>
 struct MinimizerParams {
 
@@ -13,7 +45,7 @@ struct MinimizerParams {
 
 	typedef PsimagLite::InputNg<InputCheck>::Readable InputNgReadableType;
 
-	enum EnumAlgo {NONE, SIMPLEX, CONJUGATE_GRADIENT};
+	enum EnumAlgo {NONE, SIMPLEX, CONJUGATE_GRADIENT, LBFGS, ROTOSOLVE, CMAES};
 
 	MinimizerParams(EnumAlgo algo_,
 	                SizeType maxIter_,
@@ -28,7 +60,15 @@ struct MinimizerParams {
 	      saveEvery(saveEvery_),
 	      delta(delta_),
 	      delta2(delta2_),
-	      tol(tol_)
+	      tol(tol_),
+	      memory(6),
+	      warmStart(false),
+	      threads(1),
+	      starts(1),
+	      racing(0),
+	      inheritAngles(false),
+	      fidelity(1),
+	      fidelityGenerations(10)
 	{}
 
 	MinimizerParams(InputNgReadableType& io, SizeType /*numberOfThreads*/)
@@ -38,7 +78,15 @@ struct MinimizerParams {
 	      saveEvery(0),
 	      delta(0.1),
 	      delta2(0.1),
-	      tol(1e-3)
+	      tol(1e-3),
+	      memory(6),
+	      warmStart(false),
+	      threads(1),
+	      starts(1),
+	      racing(0),
+	      inheritAngles(false),
+	      fidelity(1),
+	      fidelityGenerations(10)
 	{
 		try {
 			PsimagLite::String algoString;
@@ -66,6 +114,42 @@ struct MinimizerParams {
 			io.readline(tol, "MinimizerTolerance=");
 		} catch (std::exception&) {}
 
+		try {
+			io.readline(memory, "MinimizerMemory=");
+		} catch (std::exception&) {}
+
+		try {
+			int tmp = 0;
+			io.readline(tmp, "MinimizerWarmStart=");
+			warmStart = (tmp > 0);
+		} catch (std::exception&) {}
+
+		try {
+			io.readline(threads, "MinimizerThreads=");
+		} catch (std::exception&) {}
+
+		try {
+			io.readline(starts, "MinimizerStarts=");
+		} catch (std::exception&) {}
+
+		try {
+			io.readline(racing, "MinimizerRacing=");
+		} catch (std::exception&) {}
+
+		try {
+			int tmp = 0;
+			io.readline(tmp, "MinimizerInheritAngles=");
+			inheritAngles = (tmp > 0);
+		} catch (std::exception&) {}
+
+		try {
+			io.readline(fidelity, "MinimizerFidelity=");
+		} catch (std::exception&) {}
+
+		try {
+			io.readline(fidelityGenerations, "MinimizerFidelityGenerations=");
+		} catch (std::exception&) {}
+
 		try {
 			int tmp = 0;
 			io.readline(tmp, "MinimizerVerbose=");
@@ -79,6 +163,12 @@ struct MinimizerParams {
 			algo = EnumAlgo::CONJUGATE_GRADIENT;
 		else if (algoString == "Simplex")
 			algo = EnumAlgo::SIMPLEX;
+		else if (algoString == "LBFGS")
+			algo = EnumAlgo::LBFGS;
+		else if (algoString == "Rotosolve")
+			algo = EnumAlgo::ROTOSOLVE;
+		else if (algoString == "CMAES")
+			algo = EnumAlgo::CMAES;
 		else if (algoString == "None")
 			algo = EnumAlgo::NONE;
 		else
@@ -92,6 +182,14 @@ struct MinimizerParams {
 	RealType delta;
 	RealType delta2;
 	RealType tol;
+	SizeType memory;
+	bool warmStart;
+	SizeType threads;
+	SizeType starts;
+	RealType racing;
+	bool inheritAngles;
+	RealType fidelity;
+	SizeType fidelityGenerations;
 };
 
 
@@ -103,6 +201,14 @@ std::ostream& operator<<(std::ostream& os, const MinimizerParams<RealType>& m)
 	os<<"delta= "<<m.delta<<"\n";
 	os<<"delta2= "<<m.delta2<<"\n";
 	os<<"tolerance= "<<m.tol<<"\n";
+	os<<"memory= "<<m.memory<<"\n";
+	os<<"warmStart= "<<m.warmStart<<"\n";
+	os<<"threads= "<<m.threads<<"\n";
+	os<<"starts= "<<m.starts<<"\n";
+	os<<"racing= "<<m.racing<<"\n";
+	os<<"inheritAngles= "<<m.inheritAngles<<"\n";
+	os<<"fidelity= "<<m.fidelity<<"\n";
+	os<<"fidelityGenerations= "<<m.fidelityGenerations<<"\n";
 	os<<"verbose= "<<m.verbose<<"\n";
 	return os;
 }
@@ -55,6 +55,24 @@ public:
 	virtual void setAngle(PsimagLite::String) const
 	{}
 
+	// As setAngle() with a number, for nodes with one angle
+	virtual void bindAngle(const AnglesType&) const
+	{
+		throw PsimagLite::RuntimeError("node::bindAngle\n");
+	}
+
+	// For gates, applies the adjoint of the gate instead of the gate
+	virtual ValueType execAdjoint(const VectorValueType&) const
+	{
+		throw PsimagLite::RuntimeError("node::execAdjoint\n");
+	}
+
+	// For gates with one angle, applies the derivative of the gate with respect to it
+	virtual ValueType execDerivative(const VectorValueType&) const
+	{
+		throw PsimagLite::RuntimeError("node::execDerivative\n");
+	}
+
 	virtual void print(std::ostream&) const {}
 
 	virtual void setDcValue(const ValueType&) const
@@ -64,6 +82,12 @@ public:
 
 	virtual bool isInput() const  { return false; }
 
+	// For inputs, the index of the input
+	virtual SizeType inputIndex() const
+	{
+		throw PsimagLite::RuntimeError("node::inputIndex\n");
+	}
+
 }; // class Node
 
 template<typename VectorValueType>
@@ -256,7 +280,7 @@ class Input : public Node<VectorValueType> {
 public:
 
 	Input(SizeType i, ValueType)
-	    : char_(i+48),strOneChar_(" ")
+	    : index_(i),char_(i+48),strOneChar_(" ")
 	{
 		strOneChar_[0] = char_;
 	}
@@ -280,8 +304,11 @@ public:
 
 	virtual bool isInput() const  { return true; }
 
+	virtual SizeType inputIndex() const { return index_; }
+
 private:
 
+	SizeType index_;
 	char char_;
 	PsimagLite::String strOneChar_;
 	mutable ValueType input_;
@@ -3,6 +3,7 @@
 #include "Vector.h"
 #include "Concurrency.h"
 #include "Matrix.h"
+#include "PackedGenome.h"
 
 namespace Gep {
 
@@ -29,32 +30,85 @@ public:
 	typedef typename PsimagLite::Vector<NodeType*>::Type VectorNodeType;
 	typedef PsimagLite::Matrix<int> MatrixIntType;
 	typedef PsimagLite::Vector<PsimagLite::Concurrency::PthreadtType>::Type VectorThreadIdType;
+	typedef PsimagLite::Vector<PsimagLite::String>::Type VectorStringType;
+	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
 
-	NodeFactory(const VectorNodeType& nodes)
+	// symbols are those that are not the code of a node, like the defined constants
+	NodeFactory(const VectorNodeType& nodes,
+	            const VectorStringType& symbols = VectorStringType())
 	    : nodes_(nodes),
 	      nthreads_(PsimagLite::Concurrency::codeSectionParams.npthreads),
 	      newNodes_(nodes.size()*nthreads_)
-	{}
+	{
+		buildIndex(symbols);
+	}
 
-	const NodeType& findNodeFromCode(PsimagLite::String codeStr,
+	/* Returns the node of codeStr, for its kind only: the angle in codeStr, if any,
+	   is not parsed, so the node cannot be executed; see findNodeFromGenome() */
+	const NodeType& findNodeFromCode(const PsimagLite::String& codeStr,
 	                                 const typename NodeType::ValueType& value,
 	                                 bool isCell,
 	                                 SizeType threadNum) const
 	{
-		PsimagLite::String codeStripped = stripPreviousAngleIfAny(codeStr);
-
-		for (SizeType i = 0; i < nodes_.size(); ++i) {
-			if (isCell && nodes_[i]->isInput()) continue;
-			PsimagLite::String ncode = stripPreviousAngleIfAny(nodes_[i]->code());
-			if (ncode == codeStripped) {
-				NodeType* newNode = findOrCreateCombo(i, threadNum);
-				if (codeStr == "?") newNode->setDcValue(value);
-				newNode->setAngle(codeStr);
-				return *newNode;
-			}
+		NodeType* newNode = findOrCreateCombo(nodeIndex(opcode(codeStr), isCell), threadNum);
+		if (codeStr == "?") newNode->setDcValue(value);
+		return *newNode;
+	}
+
+	// The node of symbol i of genome, with its constant or angle set
+	const NodeType& findNodeFromGenome(const PackedGenome& genome,
+	                                   SizeType i,
+	                                   const typename NodeType::ValueType& value,
+	                                   bool isCell,
+	                                   SizeType threadNum) const
+	{
+		const SizeType op = genome.opcode(i);
+		NodeType* newNode = findOrCreateCombo(nodeIndex(op, isCell), threadNum);
+		const PsimagLite::String& code = codes_[op];
+		if (code == "?") {
+			newNode->setDcValue(value);
+			return *newNode;
 		}
 
-		throw PsimagLite::RuntimeError("findNodeWithCode\n");
+		if (genome.hasParam(i))
+			newNode->bindAngle(genome.param(i));
+		else
+			newNode->setAngle(code);
+
+		return *newNode;
+	}
+
+	/* Returns the opcode of symbol codeStr, which is the index of its interned code.
+	   The angle, if any, is ignored. */
+	SizeType opcode(const PsimagLite::String& codeStr) const
+	{
+		const SizeType len = std::find(codeStr.begin(), codeStr.end(), ':') - codeStr.begin();
+		const SizeType mask = table_.size() - 1;
+		for (SizeType slot = hash(codeStr.data(), len) & mask; table_[slot] > 0;
+		     slot = (slot + 1) & mask) {
+			const SizeType entry = table_[slot] - 1;
+			const PsimagLite::String& code = codes_[entry];
+			if (code.length() == len && code.compare(0, len, codeStr.data(), len) == 0)
+				return entry;
+		}
+
+		throw PsimagLite::RuntimeError("findNodeWithCode: " + codeStr + "\n");
+	}
+
+	// The index of the node of opcode; with isCell, inputs are ignored
+	SizeType nodeIndex(SizeType opcode, bool isCell) const
+	{
+		assert(opcode < codes_.size());
+		const SizeType ind = (isCell) ? firstNonInput_[opcode] : firstAny_[opcode];
+		if (ind < nodes_.size()) return ind;
+
+		throw PsimagLite::RuntimeError("findNodeWithCode: " + codes_[opcode] + "\n");
+	}
+
+	const PsimagLite::String& symbol(SizeType opcode) const
+	{
+		assert(opcode < codes_.size());
+		return codes_[opcode];
 	}
 
 	void sync()
@@ -64,6 +118,14 @@ public:
 		//throw PsimagLite::RuntimeError("testing sync\n");
 	}
 
+	/* Whether the gate of code has an angle: the rotations, the Givens gates,
+	   and the parametric custom gates */
+	static bool hasAngle(const PsimagLite::String& code)
+	{
+		if (code.length() == 0) return false;
+		return (code[0] == 'R' || code[0] == 'G' || code.substr(0, 2) == "PG");
+	}
+
 	static PsimagLite::String stripPreviousAngleIfAny(PsimagLite::String str)
 	{
 		typename PsimagLite::String::const_iterator it = std::find(str.begin(),
@@ -88,8 +150,62 @@ public:
 
 	SizeType numberOfNodes() const { return nodes_.size(); }
 
+	// The number of interned codes; opcodes are smaller than it
+	SizeType numberOfCodes() const { return codes_.size(); }
+
 private:
 
+	// FNV-1a
+	static SizeType hash(const char* str, SizeType len)
+	{
+		SizeType h = 2166136261u;
+		for (SizeType i = 0; i < len; ++i) {
+			h ^= static_cast<unsigned char>(str[i]);
+			h *= 16777619u;
+		}
+
+		return h;
+	}
+
+	// Codes are interned once here, and looked up in an open addressing table
+	void buildIndex(const VectorStringType& symbols)
+	{
+		const SizeType n = nodes_.size();
+		SizeType size = 2;
+		while (size < 2*(n + symbols.size())) size <<= 1;
+		table_.assign(size, 0);
+
+		for (SizeType i = 0; i < n; ++i) {
+			const SizeType entry = intern(stripPreviousAngleIfAny(nodes_[i]->code()));
+			if (firstAny_[entry] == n) firstAny_[entry] = i;
+			if (firstNonInput_[entry] == n && !nodes_[i]->isInput())
+				firstNonInput_[entry] = i;
+		}
+
+		for (SizeType i = 0; i < symbols.size(); ++i)
+			intern(symbols[i]);
+
+		if (codes_.size() > PackedGenome::maxOpcode)
+			throw PsimagLite::RuntimeError("NodeFactory: too many codes\n");
+	}
+
+	SizeType intern(const PsimagLite::String& code)
+	{
+		const SizeType mask = table_.size() - 1;
+		SizeType slot = hash(code.data(), code.length()) & mask;
+		while (table_[slot] > 0 && codes_[table_[slot] - 1] != code)
+			slot = (slot + 1) & mask;
+
+		if (table_[slot] == 0) {
+			codes_.push_back(code);
+			firstAny_.push_back(nodes_.size());
+			firstNonInput_.push_back(nodes_.size());
+			table_[slot] = codes_.size();
+		}
+
+		return table_[slot] - 1;
+	}
+
 	NodeType* findOrCreateCombo(SizeType ind, SizeType threadNum) const
 	{
 		int tId = threadNum + ind*nthreads_;
@@ -115,6 +231,10 @@ private:
 	const VectorNodeType& nodes_;
 	SizeType nthreads_;
 	mutable VectorNodeType newNodes_;
+	VectorStringType codes_;
+	VectorSizeType firstAny_;
+	VectorSizeType firstNonInput_;
+	VectorSizeType table_;
 };
 }
 #endif // NODEFACTORY_H
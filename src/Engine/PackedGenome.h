@@ -0,0 +1,133 @@
+#ifndef PACKEDGENOME_H
+#define PACKEDGENOME_H
+#include "Vector.h"
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+
+namespace Gep {
+
+/* PSIDOC PackedGenome
+The PackedGenome class holds the genome of an individual, or of part of it, as one
+16-bit opcode per symbol, where the opcode is the index of the symbol in the
+NodeFactory, plus a side array of real parameters for the symbols that have one,
+which are the angles of rotations and the values of defined constants.
+The side array is only allocated for genomes that have at least one parameter.
+The engine breeds individuals as packed genomes, and the string
+form, as in Ry0:0.5, is only used to read and print individuals; see
+Evolution::pack() and Evolution::unpack().
+*/
+class PackedGenome {
+
+	typedef std::uint16_t OpcodeType;
+
+public:
+
+	typedef double ParamType;
+	typedef PsimagLite::Vector<OpcodeType>::Type VectorOpcodeType;
+	typedef PsimagLite::Vector<ParamType>::Type VectorParamType;
+
+	static const SizeType maxOpcode = 0x7fff;
+
+	PackedGenome() {}
+
+	SizeType size() const { return opcodes_.size(); }
+
+	SizeType opcode(SizeType i) const
+	{
+		assert(i < opcodes_.size());
+		return opcodes_[i] & maxOpcode;
+	}
+
+	bool hasParam(SizeType i) const
+	{
+		assert(i < opcodes_.size());
+		return (opcodes_[i] & paramBit_);
+	}
+
+	ParamType param(SizeType i) const
+	{
+		assert(hasParam(i) && i < params_.size());
+		return params_[i];
+	}
+
+	// Sets symbol i to opcode, without parameter
+	void set(SizeType i, SizeType opcode)
+	{
+		assert(i < opcodes_.size() && opcode <= maxOpcode);
+		opcodes_[i] = opcode;
+	}
+
+	void setParam(SizeType i, ParamType value)
+	{
+		assert(i < opcodes_.size());
+		if (params_.size() == 0) params_.resize(opcodes_.size());
+		params_[i] = value;
+		opcodes_[i] |= paramBit_;
+	}
+
+	void push(SizeType opcode)
+	{
+		assert(opcode <= maxOpcode);
+		opcodes_.push_back(opcode);
+		if (params_.size() > 0) params_.push_back(0);
+	}
+
+	// Sets symbol i to symbol j of other
+	void copy(SizeType i, const PackedGenome& other, SizeType j)
+	{
+		assert(i < opcodes_.size() && j < other.opcodes_.size());
+		opcodes_[i] = other.opcodes_[j];
+		if (other.hasParam(j)) setParam(i, other.params_[j]);
+	}
+
+	// Appends the symbols [start, end) of other
+	void append(const PackedGenome& other, SizeType start, SizeType end)
+	{
+		assert(start <= end && end <= other.opcodes_.size());
+		const SizeType offset = opcodes_.size();
+		opcodes_.insert(opcodes_.end(),
+		                other.opcodes_.begin() + start,
+		                other.opcodes_.begin() + end);
+		if (params_.size() == 0 && other.params_.size() == 0) return;
+
+		params_.resize(opcodes_.size());
+		if (other.params_.size() == 0) return;
+		std::copy(other.params_.begin() + start,
+		          other.params_.begin() + end,
+		          params_.begin() + offset);
+	}
+
+	void append(const PackedGenome& other)
+	{
+		append(other, 0, other.size());
+	}
+
+	void swapSymbols(SizeType i, SizeType j)
+	{
+		assert(i < opcodes_.size() && j < opcodes_.size());
+		std::swap(opcodes_[i], opcodes_[j]);
+		if (params_.size() > 0) std::swap(params_[i], params_[j]);
+	}
+
+	bool operator==(const PackedGenome& other) const
+	{
+		if (opcodes_ != other.opcodes_) return false;
+		const SizeType n = opcodes_.size();
+		for (SizeType i = 0; i < n; ++i)
+			if (hasParam(i) && params_[i] != other.params_[i]) return false;
+		return true;
+	}
+
+	bool operator!=(const PackedGenome& other) const { return !(*this == other); }
+
+private:
+
+	static const OpcodeType paramBit_ = 0x8000;
+
+	VectorOpcodeType opcodes_;
+	VectorParamType params_;
+}; // class PackedGenome
+
+} // namespace Gep
+#endif // PACKEDGENOME_H
@@ -84,6 +84,10 @@ The EngineOptions are case-insensitive and can be none or more of the following.
 \item[noncanonical] Disables the canonicalization step.
 \item[progressBar] Prints a progress bar for each generation.
 \item[printCompact] Prints individuals in compact form.
+\item[subtreeCache] Evaluates all individuals of a generation on the same samples,
+sharing the outputs of common subtrees. Only for gep2, and without ADFs.
+\item[tuneConstants] Fits the constants of promising individuals by least squares.
+Only for gep2, only with constants, and not with subtreeCache.
 \end{itemize}
 */
 		io.readline(generations, "Generations=");
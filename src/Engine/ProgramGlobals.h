@@ -6,8 +6,9 @@ namespace Gep {
 
 namespace ProgramGlobals {
 
-static void pushVector(PsimagLite::Vector<PsimagLite::String>::Type& dest,
-                       const PsimagLite::Vector<PsimagLite::String>::Type& src,
+template<typename T>
+static void pushVector(typename PsimagLite::Vector<T>::Type& dest,
+                       const typename PsimagLite::Vector<T>::Type& src,
                        SizeType upTo = 0)
 {
 	const SizeType total = src.size();
@@ -0,0 +1,241 @@
+#ifndef SUBTREECACHE_H
+#define SUBTREECACHE_H
+#include "Vector.h"
+#include <unordered_map>
+#include <deque>
+#include <mutex>
+
+namespace Gep {
+
+/* PSIDOC SubtreeCache
+The SubtreeCache class hash-conses expression trees into a DAG shared by all
+individuals of the population, whichever thread evaluates them. Each unique
+subtree is stored once, keyed by its node code (and constant value for defined
+constants) and by the DAG indices of its descendants. The output of each unique
+subtree is computed for the whole batch of samples once, by the first thread
+that needs it, and then reused by every individual that contains it, until the
+next call to setBatch(). Lookups and insertions take a lock; the outputs of a
+subtree are computed outside of it, once per subtree.
+*/
+template<typename TreeType>
+class SubtreeCache {
+
+	typedef typename TreeType::NodeType NodeType;
+	typedef typename TreeType::ValueType ValueType;
+	typedef typename TreeType::VectorValueType VectorValueType;
+	typedef typename PsimagLite::Vector<VectorValueType>::Type VectorVectorValueType;
+	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
+
+	static const SizeType npos_ = static_cast<SizeType>(-1);
+
+	struct DagKey {
+
+		DagKey(PsimagLite::String code_, ValueType constant_)
+		    : code(code_), constant(constant_)
+		{}
+
+		bool operator==(const DagKey& other) const
+		{
+			return (code == other.code &&
+			        constant == other.constant &&
+			        children == other.children);
+		}
+
+		PsimagLite::String code;
+		ValueType constant;
+		VectorSizeType children;
+	};
+
+	struct DagKeyHash {
+
+		SizeType operator()(const DagKey& key) const
+		{
+			SizeType h = std::hash<PsimagLite::String>()(key.code);
+			h ^= std::hash<ValueType>()(key.constant) + 0x9e3779b9 + (h << 6) + (h >> 2);
+			for (SizeType i = 0; i < key.children.size(); ++i)
+				h ^= key.children[i] + 0x9e3779b9 + (h << 6) + (h >> 2);
+			return h;
+		}
+	};
+
+	struct DagEntry {
+
+		DagEntry(const DagKey& key_, SizeType index_, const NodeType* node_, SizeType input_)
+		    : key(key_), index(index_), node(node_), input(input_)
+		{}
+
+		DagKey key;
+		SizeType index;
+		const NodeType* node;
+		SizeType input; // the index of the input for inputs, else npos
+		typename PsimagLite::Vector<DagEntry*>::Type children;
+		std::once_flag computed;
+		VectorValueType values;
+	};
+
+	typedef std::unordered_map<DagKey, DagEntry*, DagKeyHash> MapKeyToEntryType;
+
+	class Dag {
+
+	public:
+
+		Dag() : hits_(0) {}
+
+		~Dag()
+		{
+			clear();
+		}
+
+		// Not thread safe
+		void clear()
+		{
+			index_.clear();
+			entries_.clear();
+			hits_ = 0;
+			for (auto it = prototypes_.begin(); it != prototypes_.end(); ++it)
+				delete it->second;
+			prototypes_.clear();
+		}
+
+		DagEntry* intern(const TreeType& tree)
+		{
+			const NodeType& node = tree.node();
+			const bool isConstant = (node.arity() == 0 && !node.isInput());
+			const ValueType constant = (isConstant) ? tree.exec() : ValueType(0);
+			DagKey key(node.code(), constant);
+			const SizeType n = tree.descendants().size();
+			typename PsimagLite::Vector<DagEntry*>::Type children(n);
+			for (SizeType i = 0; i < n; ++i) {
+				children[i] = intern(*tree.descendants()[i]);
+				key.children.push_back(children[i]->index);
+			}
+
+			std::lock_guard<std::mutex> lock(mutex_);
+			auto it = index_.find(key);
+			if (it != index_.end()) {
+				++hits_;
+				return it->second;
+			}
+
+			const NodeType* ptr = (node.arity() > 0) ? prototype(node) : nullptr;
+			const SizeType input = (node.isInput()) ? node.inputIndex() : npos_;
+			entries_.emplace_back(key, entries_.size(), ptr, input);
+			DagEntry* entry = &entries_.back();
+			entry->children.swap(children);
+			index_[key] = entry;
+			return entry;
+		}
+
+		const VectorValueType& values(DagEntry& entry, const VectorVectorValueType& inputs)
+		{
+			std::call_once(entry.computed, [&entry, &inputs]() { compute(entry, inputs); });
+			return entry.values;
+		}
+
+		SizeType size() const { return entries_.size(); }
+
+		SizeType hits() const { return hits_; }
+
+	private:
+
+		// Nodes from the NodeFactory are deleted on sync(); keep our own copies
+		const NodeType* prototype(const NodeType& node)
+		{
+			const PsimagLite::String code = node.code();
+			auto it = prototypes_.find(code);
+			if (it != prototypes_.end()) return it->second;
+
+			NodeType* copy = node.clone();
+			prototypes_[code] = copy;
+			return copy;
+		}
+
+		static void compute(DagEntry& entry, const VectorVectorValueType& inputs)
+		{
+			const SizeType samples = inputs.size();
+			const SizeType arity = entry.children.size();
+
+			// descendants first
+			for (SizeType j = 0; j < arity; ++j) {
+				DagEntry& child = *entry.children[j];
+				std::call_once(child.computed, [&child, &inputs]() { compute(child, inputs); });
+			}
+
+			entry.values.resize(samples);
+			if (arity == 0) {
+				fillLeaf(entry, inputs);
+				return;
+			}
+
+			VectorValueType args(arity);
+			for (SizeType i = 0; i < samples; ++i) {
+				for (SizeType j = 0; j < arity; ++j)
+					args[j] = entry.children[j]->values[i];
+				entry.values[i] = entry.node->exec(args);
+			}
+		}
+
+		static void fillLeaf(DagEntry& entry, const VectorVectorValueType& inputs)
+		{
+			const SizeType samples = inputs.size();
+			if (entry.input == npos_) {
+				std::fill(entry.values.begin(), entry.values.end(), entry.key.constant);
+				return;
+			}
+
+			const SizeType index = entry.input;
+			for (SizeType i = 0; i < samples; ++i) {
+				assert(index < inputs[i].size());
+				entry.values[i] = inputs[i][index];
+			}
+		}
+
+		// entries never move, so that pointers to them stay valid
+		std::deque<DagEntry> entries_;
+		MapKeyToEntryType index_;
+		std::unordered_map<PsimagLite::String, NodeType*> prototypes_;
+		SizeType hits_;
+		std::mutex mutex_;
+	};
+
+public:
+
+	SubtreeCache() {}
+
+	// inputs[i] are the values of the inputs for sample i; not thread safe
+	void setBatch(const VectorVectorValueType& inputs)
+	{
+		inputs_ = inputs;
+		dag_.clear();
+	}
+
+	const VectorVectorValueType& inputs() const { return inputs_; }
+
+	SizeType samples() const { return inputs_.size(); }
+
+	// Returns the output of tree for all samples in the current batch
+	const VectorValueType& operator()(const TreeType& tree)
+	{
+		DagEntry* entry = dag_.intern(tree);
+		return dag_.values(*entry, inputs_);
+	}
+
+	void printStats(std::ostream& os) const
+	{
+		os<<"SubtreeCache: unique subtrees= "<<dag_.size()<<" reused= "<<dag_.hits()<<"\n";
+	}
+
+private:
+
+	SubtreeCache(const SubtreeCache&) = delete;
+
+	SubtreeCache& operator=(const SubtreeCache&) = delete;
+
+	VectorVectorValueType inputs_;
+	Dag dag_;
+};
+
+template<typename TreeType>
+const SizeType SubtreeCache<TreeType>::npos_;
+} // namespace Gep
+#endif // SUBTREECACHE_H
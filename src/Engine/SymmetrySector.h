@@ -0,0 +1,201 @@
+#ifndef SYMMETRYSECTOR_H
+#define SYMMETRYSECTOR_H
+#include "Vector.h"
+#include "PsimagLite.h"
+
+namespace Gep {
+
+/* PSIDOC SymmetrySector
+With SymmetrySector="particles:$k$" in the input file, for RunType=``GroundState'',
+quantumGEP simulates only the states of $N$ bits that have $k$ bits set,
+and with SymmetrySector="parity:$p$" only those whose number of bits set is even,
+for $p=0$, or odd, for $p=1$. State vectors then have $\binom{N}{k}$ or $2^{N-1}$
+entries instead of $2^N$, for example about 5.7 times fewer for $k=10$ and $N=20$.
+The states of the sector are kept in increasing order, and the $i$-th state
+of $k$ bits set is found from $i=\sum_t \binom{b_t}{t+1}$, where $b_0<b_1<\ldots$ are its bits set.
+The initial vector, still given with $2^N$ entries, must lie in the sector, and the Hamiltonian,
+which is restricted to the sector, must conserve the symmetry; Hamiltonians from expressions,
+xx, zxz and text files can be used, but not Ising, matrix-free or binary ones, nor Basis=,
+and Rotosolve cannot be used. Gates act on the sector only: the
+amplitudes that a gate sends out of the sector, for example those of a Hadamard gate
+under particle number, are dropped. Such individuals are flagged: their energy
+$\langle\psi|H|\psi\rangle + g(1 - \langle\psi|\psi\rangle)$, where $g$ is the largest sum of the
+absolute values of a row of $H$, is never lower than that of their normalized states, and
+their lost weight $1 - \langle\psi|\psi\rangle$ is printed as leak=.
+The gates $G$, with Primitives= including G, rotate by an angle the pairs of states
+that differ in two bits, one set and one not, and are the gates that mix the states
+of the sector without leaving it; SymmetrySector needs them.
+*/
+class SymmetrySector {
+
+public:
+
+	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
+	typedef PsimagLite::Vector<VectorSizeType>::Type VectorVectorSizeType;
+
+	enum class KindEnum {NONE, PARTICLES, PARITY};
+
+	SymmetrySector() : kind_(KindEnum::NONE), bits_(0), value_(0), size_(0) {}
+
+	// spec is "particles:k" or "parity:p", or empty for no sector
+	SymmetrySector(PsimagLite::String spec, SizeType bits)
+	    : kind_(KindEnum::NONE), bits_(bits), value_(0), size_(static_cast<SizeType>(1) << bits)
+	{
+		if (spec == "") return;
+
+		const long unsigned int colon = spec.find(":");
+		if (colon == PsimagLite::String::npos)
+			err("SymmetrySector=" + spec + " must be particles:k or parity:p\n");
+
+		const PsimagLite::String kind = spec.substr(0, colon);
+		value_ = PsimagLite::atoi(spec.substr(colon + 1, spec.length() - colon - 1));
+		if (kind == "particles") {
+			if (value_ > bits_)
+				err("SymmetrySector: more particles than bits\n");
+
+			kind_ = KindEnum::PARTICLES;
+			fillBinomial();
+			size_ = binomial_[bits_][value_];
+			states_.resize(size_);
+			for (SizeType i = 0; i < size_; ++i)
+				states_[i] = unrank(i);
+		} else if (kind == "parity") {
+			if (value_ > 1) err("SymmetrySector: parity must be 0 or 1\n");
+
+			kind_ = KindEnum::PARITY;
+			size_ = (static_cast<SizeType>(1) << bits_)/2;
+		} else {
+			err("SymmetrySector=" + spec + " must be particles:k or parity:p\n");
+		}
+	}
+
+	bool isActive() const { return (kind_ != KindEnum::NONE); }
+
+	// The number of states of the sector, or 2^N if there is no sector
+	SizeType size() const { return size_; }
+
+	// The state of index i of the sector
+	SizeType state(SizeType i) const
+	{
+		assert(i < size_);
+		switch (kind_) {
+		case KindEnum::PARTICLES:
+			return states_[i];
+		case KindEnum::PARITY:
+			return (i << 1) | (parity(i) ^ value_);
+		default:
+			return i;
+		}
+	}
+
+	// The index of state in the sector, or size() if state is not in the sector
+	SizeType index(SizeType state) const
+	{
+		switch (kind_) {
+		case KindEnum::PARTICLES: {
+			if (static_cast<SizeType>(__builtin_popcountl(state)) != value_) return size_;
+
+			SizeType i = 0;
+			SizeType t = 1;
+			for (SizeType bit = 0; state > 0; ++bit, state >>= 1) {
+				if ((state & 1) == 0) continue;
+				i += binomial_[bit][t++];
+			}
+
+			return i;
+		}
+
+		case KindEnum::PARITY:
+			return (parity(state) == value_) ? (state >> 1) : size_;
+		default:
+			return state;
+		}
+	}
+
+	/* Replaces full, with 2^N entries, by its entries in the sector; errs if
+	   full has weight out of the sector */
+	template<typename VectorType>
+	void compress(VectorType& full, PsimagLite::String what) const
+	{
+		if (!isActive()) return;
+
+		const SizeType hilbert = (static_cast<SizeType>(1) << bits_);
+		if (full.size() != hilbert)
+			err(what + " has " + ttos(full.size()) + " entries instead of " + ttos(hilbert) + "\n");
+
+		VectorType v(size_);
+		double outside = 0;
+		for (SizeType s = 0; s < hilbert; ++s) {
+			const SizeType i = index(s);
+			if (i < size_)
+				v[i] = full[s];
+			else
+				outside += std::norm(full[s]);
+		}
+
+		if (outside > 1e-12)
+			err(what + " has weight " + ttos(outside) + " out of the symmetry sector\n");
+
+		full.swap(v);
+	}
+
+	// Replaces v, in the sector, by its 2^N entries
+	template<typename VectorType>
+	void expand(VectorType& v) const
+	{
+		if (!isActive()) return;
+
+		assert(v.size() == size_);
+		VectorType full(static_cast<SizeType>(1) << bits_);
+		for (SizeType i = 0; i < size_; ++i)
+			full[state(i)] = v[i];
+
+		full.swap(v);
+	}
+
+private:
+
+	static SizeType parity(SizeType state)
+	{
+		return (__builtin_popcountl(state) & 1);
+	}
+
+	// binomial_[n][m] is n choose m, for n <= bits_ and m <= value_ + 1
+	void fillBinomial()
+	{
+		binomial_.resize(bits_ + 1);
+		for (SizeType n = 0; n <= bits_; ++n) {
+			binomial_[n].resize(value_ + 2, 0);
+			binomial_[n][0] = 1;
+			for (SizeType m = 1; m <= std::min(n, value_ + 1); ++m)
+				binomial_[n][m] = binomial_[n - 1][m - 1] + ((m < n) ? binomial_[n - 1][m] : 0);
+		}
+	}
+
+	// The state of index i with value_ bits set, bits taken from the highest down
+	SizeType unrank(SizeType i) const
+	{
+		SizeType state = 0;
+		SizeType bit = bits_;
+		for (SizeType t = value_; t > 0; --t) {
+			do {
+				--bit;
+			} while (binomial_[bit][t] > i);
+
+			state |= (static_cast<SizeType>(1) << bit);
+			i -= binomial_[bit][t];
+		}
+
+		return state;
+	}
+
+	KindEnum kind_;
+	SizeType bits_;
+	SizeType value_;
+	SizeType size_;
+	VectorVectorSizeType binomial_;
+	VectorSizeType states_;
+}; // class SymmetrySector
+
+} // namespace Gep
+#endif // SYMMETRYSECTOR_H
@@ -37,7 +37,9 @@ public:
 	Tree(const PrimitivesType& primitives,const NodeType& node, bool verbose)
 	    : primitives_(primitives),
 	      node_(node),
-	      verbose_(verbose)
+	      verbose_(verbose),
+	      isDc_(false),
+	      dcValue_()
 	{}
 
 	~Tree()
@@ -46,6 +48,8 @@ public:
 	ValueType exec() const
 	{
 		if (verbose_) std::cout<<" type= "<<node_.code()<<"\n";
+		if (isDc_) return dcValue_;
+
 		VectorValueType values(descendants_.size());
 
 		for (SizeType i = 0; i < descendants_.size(); i++) {
@@ -85,6 +89,23 @@ public:
 		node_.set(values[index]);
 	}
 
+	const NodeType& node() const { return node_; }
+
+	// A defined constant keeps its own value, because its node is shared
+	void setDcValue(const ValueType& value)
+	{
+		isDc_ = true;
+		dcValue_ = value;
+	}
+
+	bool isDc() const { return isDc_; }
+
+	const ValueType& dcValue() const { return dcValue_; }
+
+	const VectorTreeType& descendants() const { return descendants_; }
+
+	void clearDescendants() { descendants_.clear(); }
+
 	void setDescendants(const TreeType& n0)
 	{
 		descendants_.push_back(&n0);
@@ -103,6 +124,8 @@ private:
 	const PrimitivesType& primitives_;
 	const NodeType& node_;
 	bool verbose_;
+	bool isDc_;
+	ValueType dcValue_;
 	VectorTreeType descendants_;
 };
 
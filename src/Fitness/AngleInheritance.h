@@ -0,0 +1,138 @@
+#ifndef ANGLEINHERITANCE_H
+#define ANGLEINHERITANCE_H
+#include "Vector.h"
+#include "PsimagLite.h"
+#include "Concurrency.h"
+#include "PackedGenome.h"
+#include <unordered_set>
+#include <mutex>
+
+namespace Gep {
+
+/* PSIDOC AngleInheritance
+The genome of a child keeps the angles of the symbols that it copies from its
+parents, because recombination, mutation, inversion and swap move each angle
+together with its gate, so that only new gates start from random angles. By
+default, however, the genome of an individual only keeps the angles of a minimization
+that converged. With MinimizerInheritAngles=1 in the input file, it keeps the
+best angles found even if the minimizer did not converge, so that children start
+from them. Then, at the start of each generation, the number of angles of the
+previous generation that started from inherited values is printed to
+standard error, together with the mean number of iterations of the minimizations
+that started from inherited angles only, and of those that started from some random angles,
+which shows how many iterations inheriting saves. Only the minimizations of new children
+are counted; the survivors, which start again from the angles of their own earlier
+minimization, and later rounds of a race, are not.
+*/
+class AngleInheritance {
+
+	struct Counts {
+
+		Counts() : inherited(0), angles(0)
+		{
+			minimizations[0] = minimizations[1] = 0;
+			iterations[0] = iterations[1] = 0;
+		}
+
+		// index 0 for all angles inherited, 1 for some random ones
+		SizeType minimizations[2];
+		SizeType iterations[2];
+		SizeType inherited;
+		SizeType angles;
+	};
+
+public:
+
+	AngleInheritance()
+	    : counts_(PsimagLite::Concurrency::codeSectionParams.npthreads)
+	{}
+
+	// Records a minimization of angles angles, inherited of them, in iterations iterations
+	void add(SizeType threadNum, SizeType inherited, SizeType angles, SizeType iterations)
+	{
+		assert(threadNum < counts_.size());
+		Counts& counts = counts_[threadNum];
+		const SizeType index = (inherited == angles) ? 0 : 1;
+		++counts.minimizations[index];
+		counts.iterations[index] += iterations;
+		counts.inherited += inherited;
+		counts.angles += angles;
+	}
+
+	// Records that genome holds the angles of a minimization
+	void minimized(const PackedGenome& genome)
+	{
+		const SizeType h = hash(genome);
+		std::lock_guard<std::mutex> lock(mutex_);
+		current_.insert(h);
+	}
+
+	/* Whether genome holds the angles of a minimization of this generation or the
+	   previous one, as survivors do, instead of angles from its parents */
+	bool isMinimized(const PackedGenome& genome)
+	{
+		const SizeType h = hash(genome);
+		std::lock_guard<std::mutex> lock(mutex_);
+		return (current_.count(h) > 0 || previous_.count(h) > 0);
+	}
+
+	// Prints the counts of generation, the one that just ended, and clears them
+	void print(std::ostream& os, SizeType generation)
+	{
+		Counts sum;
+		for (SizeType i = 0; i < counts_.size(); ++i) {
+			for (SizeType j = 0; j < 2; ++j) {
+				sum.minimizations[j] += counts_[i].minimizations[j];
+				sum.iterations[j] += counts_[i].iterations[j];
+			}
+
+			sum.inherited += counts_[i].inherited;
+			sum.angles += counts_[i].angles;
+			counts_[i] = Counts();
+		}
+
+		if (sum.angles == 0) return;
+
+		os<<"AngleInheritance: generation= "<<generation;
+		os<<" inherited angles= "<<sum.inherited<<" of "<<sum.angles;
+		os<<"; iterations per minimization= "<<mean(sum, 0)<<" inherited ";
+		os<<"("<<sum.minimizations[0]<<"), "<<mean(sum, 1)<<" random ";
+		os<<"("<<sum.minimizations[1]<<")\n";
+	}
+
+	void startGeneration()
+	{
+		previous_.swap(current_);
+		current_.clear();
+	}
+
+private:
+
+	static SizeType hash(const PackedGenome& genome)
+	{
+		SizeType h = 0;
+		const SizeType n = genome.size();
+		for (SizeType i = 0; i < n; ++i) {
+			h ^= genome.opcode(i) + 0x9e3779b9 + (h << 6) + (h >> 2);
+			if (!genome.hasParam(i)) continue;
+			h ^= std::hash<PackedGenome::ParamType>()(genome.param(i)) +
+			        0x9e3779b9 + (h << 6) + (h >> 2);
+		}
+
+		return h;
+	}
+
+	static double mean(const Counts& counts, SizeType index)
+	{
+		if (counts.minimizations[index] == 0) return 0;
+		return static_cast<double>(counts.iterations[index])/counts.minimizations[index];
+	}
+
+	PsimagLite::Vector<Counts>::Type counts_;
+	std::unordered_set<SizeType> current_;
+	std::unordered_set<SizeType> previous_;
+	std::mutex mutex_;
+}; // class AngleInheritance
+
+} // namespace Gep
+#endif // ANGLEINHERITANCE_H
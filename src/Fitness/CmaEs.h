@@ -0,0 +1,240 @@
+#ifndef CMAES_H
+#define CMAES_H
+#include "Vector.h"
+#include "PsimagLite.h"
+#include "Matrix.h"
+#include "Sort.h"
+
+namespace Gep {
+
+/* PSIDOC CmaEs
+When MinimizerAlgorithm=``CMAES'' in the input file, which is only supported
+for RunType=``GroundState'', the angles are minimized with the covariance matrix
+adaptation evolution strategy. Each iteration samples
+$\lambda = 4 + \lfloor 3\ln n\rfloor$ vectors of the $n$ angles from a normal distribution, and
+evaluates their energies as a batch on MinimizerThreads threads, each with its own
+copy of the gates, so that a single large circuit can use several cores when
+the individuals are evaluated one at a time, that is, with Threads=1; otherwise
+MinimizerThreads is ignored. The best half of the vectors then
+moves the mean and adapts the step size and the covariance of the distribution.
+The first step size is MinimizerDelta.
+The energy has period $2\pi$ in the angle of each rotation, so the
+mean of those angles is kept in $[0, 2\pi)$, and the step size is capped so
+that the distribution is never wider than a period, beyond which
+sampling would be no better than uniform. The minimization converges
+when the distribution is narrower than MinimizerTolerance in every direction, and
+returns the best vector of angles found.
+*/
+template<typename FunctionType>
+class CmaEs {
+
+public:
+
+	typedef typename FunctionType::FieldType RealType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef typename PsimagLite::Vector<VectorRealType>::Type VectorVectorRealType;
+	typedef PsimagLite::Matrix<RealType> MatrixRealType;
+	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
+
+	CmaEs(FunctionType& function, SizeType maxIter, SizeType threads, bool verbose)
+	    : function_(function),
+	      maxIter_(maxIter),
+	      threads_(std::max(threads, static_cast<SizeType>(1))),
+	      verbose_(verbose),
+	      converged_(false)
+	{}
+
+	bool converged() const { return converged_; }
+
+	// Minimizes starting at x with step sigma, and returns the number of iterations
+	template<typename SomeRngType>
+	int minimize(VectorRealType& x, RealType sigma, RealType tol, SomeRngType& rng)
+	{
+		const SizeType n = x.size();
+		const SizeType lambda = 4 + static_cast<SizeType>(3*log(static_cast<RealType>(n)));
+		const SizeType mu = lambda/2;
+
+		VectorRealType weights(mu);
+		RealType sum = 0;
+		for (SizeType i = 0; i < mu; ++i) {
+			weights[i] = log(mu + 0.5) - log(i + 1.0);
+			sum += weights[i];
+		}
+
+		RealType sum2 = 0;
+		for (SizeType i = 0; i < mu; ++i) {
+			weights[i] /= sum;
+			sum2 += weights[i]*weights[i];
+		}
+
+		const RealType mueff = 1/sum2;
+		const RealType cc = (4 + mueff/n)/(n + 4 + 2*mueff/n);
+		const RealType cs = (mueff + 2)/(n + mueff + 5);
+		const RealType c1 = 2/((n + 1.3)*(n + 1.3) + mueff);
+		const RealType cmu = std::min(1 - c1,
+		                              2*(mueff - 2 + 1/mueff)/((n + 2.0)*(n + 2.0) + mueff));
+		const RealType damps = 1 + 2*std::max(static_cast<RealType>(0),
+		                                      sqrt((mueff - 1)/(n + 1)) - 1) + cs;
+		// the distribution is never wider than half the period of the rotations
+		const RealType maxWidth = M_PI;
+		const RealType chiN = sqrt(static_cast<RealType>(n))*(1 - 1.0/(4*n) + 1.0/(21*n*n));
+
+		VectorRealType mean = x;
+		VectorRealType pc(n, 0);
+		VectorRealType ps(n, 0);
+		MatrixRealType c(n, n);
+		MatrixRealType b(n, n);
+		VectorRealType d(n, 1);
+		for (SizeType i = 0; i < n; ++i)
+			c(i, i) = b(i, i) = 1;
+
+		RealType best = function_(x);
+		VectorVectorRealType z(lambda, VectorRealType(n));
+		VectorVectorRealType candidates(lambda, VectorRealType(n));
+		VectorRealType energies(lambda);
+		VectorSizeType iperm(lambda);
+		converged_ = false;
+		SizeType iter = 0;
+		for (; iter < maxIter_; ++iter) {
+			sigma = std::min(sigma, maxWidth/maxOf(d));
+			for (SizeType k = 0; k < lambda; ++k) {
+				for (SizeType i = 0; i < n; ++i)
+					z[k][i] = gaussian(rng);
+
+				for (SizeType i = 0; i < n; ++i) {
+					RealType tmp = 0;
+					for (SizeType j = 0; j < n; ++j)
+						tmp += b(i, j)*d[j]*z[k][j];
+					candidates[k][i] = mean[i] + sigma*tmp;
+				}
+			}
+
+			function_.energies(energies, candidates, threads_);
+			PsimagLite::Sort<VectorRealType> sort;
+			sort.sort(energies, iperm);
+			if (energies[0] < best) {
+				best = energies[0];
+				x = candidates[iperm[0]];
+			}
+
+			// the new mean, and the steps y = (new - old)/sigma of the best mu
+			VectorRealType yw(n, 0);
+			VectorVectorRealType y(mu, VectorRealType(n));
+			for (SizeType k = 0; k < mu; ++k) {
+				for (SizeType i = 0; i < n; ++i) {
+					y[k][i] = (candidates[iperm[k]][i] - mean[i])/sigma;
+					yw[i] += weights[k]*y[k][i];
+				}
+			}
+
+			for (SizeType i = 0; i < n; ++i)
+				mean[i] += sigma*yw[i];
+
+			// ps uses C^{-1/2} yw = B D^{-1} B^T yw
+			VectorRealType tmp(n, 0);
+			for (SizeType j = 0; j < n; ++j) {
+				RealType dotj = 0;
+				for (SizeType i = 0; i < n; ++i)
+					dotj += b(i, j)*yw[i];
+				tmp[j] = dotj/d[j];
+			}
+
+			const RealType factorS = sqrt(cs*(2 - cs)*mueff);
+			for (SizeType i = 0; i < n; ++i) {
+				RealType sumi = 0;
+				for (SizeType j = 0; j < n; ++j)
+					sumi += b(i, j)*tmp[j];
+				ps[i] = (1 - cs)*ps[i] + factorS*sumi;
+			}
+
+			const RealType psNorm = sqrt(dot(ps, ps));
+			const RealType decay = 1 - pow(1 - cs, 2.0*(iter + 1));
+			const bool hsig = (psNorm/sqrt(decay)/chiN < 1.4 + 2.0/(n + 1));
+			const RealType factorC = sqrt(cc*(2 - cc)*mueff);
+			for (SizeType i = 0; i < n; ++i)
+				pc[i] = (1 - cc)*pc[i] + ((hsig) ? factorC*yw[i] : 0);
+
+			const RealType deltaH = (hsig) ? 0 : cc*(2 - cc);
+			for (SizeType i = 0; i < n; ++i) {
+				for (SizeType j = 0; j <= i; ++j) {
+					RealType rankMu = 0;
+					for (SizeType k = 0; k < mu; ++k)
+						rankMu += weights[k]*y[k][i]*y[k][j];
+					c(i, j) = (1 - c1 - cmu)*c(i, j) + c1*(pc[i]*pc[j] + deltaH*c(i, j)) +
+					        cmu*rankMu;
+					c(j, i) = c(i, j);
+				}
+			}
+
+			sigma *= exp(std::min(static_cast<RealType>(1), (cs/damps)*(psNorm/chiN - 1)));
+
+			eigen(b, d, c);
+			wrapAngles(mean);
+
+			if (verbose_)
+				std::cerr<<"CmaEs: iter= "<<iter<<" best= "<<best<<" sigma= "<<sigma<<"\n";
+
+			if (sigma*maxOf(d) < tol) {
+				converged_ = true;
+				break;
+			}
+		}
+
+		wrapAngles(x);
+		return iter;
+	}
+
+private:
+
+	// c = b diag(d^2) b^T
+	static void eigen(MatrixRealType& b, VectorRealType& d, const MatrixRealType& c)
+	{
+		const SizeType n = c.rows();
+		b = c;
+		VectorRealType eigs(n);
+		diag(b, eigs, 'V');
+		for (SizeType i = 0; i < n; ++i)
+			d[i] = sqrt(std::max(eigs[i], static_cast<RealType>(1e-20)));
+	}
+
+	void wrapAngles(VectorRealType& x) const
+	{
+		const SizeType n = x.size();
+		for (SizeType i = 0; i < n; ++i) {
+			if (!function_.isPeriodic(i)) continue;
+			x[i] = fmod(x[i], 2*M_PI);
+			if (x[i] < 0) x[i] += 2*M_PI;
+		}
+	}
+
+	// Box-Muller
+	template<typename SomeRngType>
+	static RealType gaussian(SomeRngType& rng)
+	{
+		RealType u1 = rng();
+		while (u1 <= 0) u1 = rng();
+		return sqrt(-2*log(u1))*cos(2*M_PI*rng());
+	}
+
+	static RealType dot(const VectorRealType& a, const VectorRealType& b)
+	{
+		RealType sum = 0;
+		for (SizeType i = 0; i < a.size(); ++i)
+			sum += a[i]*b[i];
+		return sum;
+	}
+
+	static RealType maxOf(const VectorRealType& v)
+	{
+		return *std::max_element(v.begin(), v.end());
+	}
+
+	FunctionType& function_;
+	SizeType maxIter_;
+	SizeType threads_;
+	bool verbose_;
+	bool converged_;
+}; // class CmaEs
+
+} // namespace Gep
+#endif // CMAES_H
@@ -0,0 +1,289 @@
+#ifndef COMPACTCRS_H
+#define COMPACTCRS_H
+#include "Vector.h"
+#include "PsimagLite.h"
+#include "Matrix.h"
+#include "CrsMatrix.h"
+#include "MappedCrs.h"
+#include <algorithm>
+#include <memory>
+#include <fstream>
+
+namespace Gep {
+
+/* PSIDOC CompactCrs
+Hamiltonians kept as sparse matrices are stored, once built, in the least
+memory they need. If all their entries are real, as for xx, zxz and most
+Hamiltonians from files, only the real parts are kept. If they are
+Hermitian, only the upper triangle, diagonal included, is kept, and
+$\langle y|H|y\rangle = \sum_r (H_{rr}|y_r|^2 + 2{\rm Re}\, y_r^*\sum_{c>r} H_{rc}y_c)$;
+this is done for Hilbert spaces of at least 4096 states, always with
+HamiltonianHermitian=1 in the input file, and never with HamiltonianHermitian=0.
+Together, the two cut the memory for the values, and the bandwidth to read them, by up to 4 times.
+Smaller spaces keep both triangles so that their energies round as with the full matrix.
+Binary matrices, described next, are used as stored; with HamiltonianHermitian=1
+they must keep only the upper triangle.
+*/
+template<typename ComplexType>
+class CompactCrs {
+
+public:
+
+	typedef typename PsimagLite::Real<ComplexType>::Type RealType;
+	typedef typename PsimagLite::Vector<ComplexType>::Type VectorType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
+	typedef PsimagLite::Matrix<ComplexType> MatrixType;
+	typedef std::shared_ptr<const MappedCrs> MappedCrsPointerType;
+
+	CompactCrs() : rows_(0), isReal_(true), isUpper_(false) {}
+
+	// Uses the arrays of mapped in place
+	explicit CompactCrs(MappedCrsPointerType mapped)
+	    : rows_(mapped->rows()),
+	      isReal_(mapped->isReal()),
+	      isUpper_(mapped->isUpper()),
+	      mapped_(mapped)
+	{
+		if (sizeof(RealType) != sizeof(MappedCrs::RealType))
+			err("CompactCrs: binary matrices need double precision\n");
+	}
+
+	/* Copies matrix, with real values if they are all real, and only its
+	   upper triangle if upper is true and matrix is Hermitian */
+	template<typename SparseMatrixType>
+	CompactCrs(const SparseMatrixType& matrix, bool upper)
+	    : rows_(matrix.rows()),
+	      isReal_(true),
+	      isUpper_(upper && isHermitian(matrix))
+	{
+		for (SizeType k = 0; k < matrix.getRowPtr(rows_); ++k) {
+			if (std::imag(matrix.getValue(k)) == 0) continue;
+			isReal_ = false;
+			break;
+		}
+
+		rowPtr_.resize(rows_ + 1);
+		for (SizeType r = 0; r < rows_; ++r) {
+			rowPtr_[r] = col_.size();
+			for (SizeType k = matrix.getRowPtr(r); k < matrix.getRowPtr(r + 1); ++k) {
+				const SizeType c = matrix.getCol(k);
+				if (isUpper_ && c < r) continue;
+				col_.push_back(c);
+				if (isReal_)
+					valuesReal_.push_back(PsimagLite::real(matrix.getValue(k)));
+				else
+					values_.push_back(matrix.getValue(k));
+			}
+		}
+
+		rowPtr_[rows_] = col_.size();
+	}
+
+	SizeType rows() const { return rows_; }
+
+	bool isReal() const { return isReal_; }
+
+	bool isUpper() const { return isUpper_; }
+
+	const SizeType* rowPtr() const { return (mapped_) ? mapped_->rowPtr() : rowPtr_.data(); }
+
+	const SizeType* col() const { return (mapped_) ? mapped_->col() : col_.data(); }
+
+	const RealType* valuesReal() const
+	{
+		return (mapped_) ? reinterpret_cast<const RealType*>(mapped_->valuesReal())
+		                 : valuesReal_.data();
+	}
+
+	const ComplexType* values() const
+	{
+		return (mapped_) ? reinterpret_cast<const ComplexType*>(mapped_->values())
+		                 : values_.data();
+	}
+
+	// the rows in [start, end) of <y|H|y>
+	RealType expectation(const VectorType& y, SizeType start, SizeType end) const
+	{
+		assert(y.size() == rows_);
+		return (isReal_) ? expectation(valuesReal(), y, start, end)
+		                 : expectation(values(), y, start, end);
+	}
+
+	// x += H*y
+	void matrixVectorProduct(VectorType& x, const VectorType& y) const
+	{
+		assert(x.size() == rows_ && y.size() == rows_);
+		if (isReal_)
+			matrixVectorProduct(x, y, valuesReal());
+		else
+			matrixVectorProduct(x, y, values());
+	}
+
+	MatrixType toDense() const
+	{
+		const SizeType* rowPtr = this->rowPtr();
+		const SizeType* col = this->col();
+		MatrixType m(rows_, rows_);
+		for (SizeType r = 0; r < rows_; ++r) {
+			for (SizeType k = rowPtr[r]; k < rowPtr[r + 1]; ++k) {
+				const SizeType c = col[k];
+				const ComplexType value = (isReal_) ? valuesReal()[k] : values()[k];
+				m(r, c) += value;
+				if (isUpper_ && c != r) m(c, r) += PsimagLite::conj(value);
+			}
+		}
+
+		return m;
+	}
+
+	/* Converts the text matrix in textFile, its rows and columns followed by
+	   its entries row by row, to the binary matrix binaryFile */
+	static void fromText(PsimagLite::String textFile, PsimagLite::String binaryFile)
+	{
+		if (sizeof(RealType) != sizeof(MappedCrs::RealType))
+			err("CompactCrs::fromText(): binary matrices need double precision\n");
+
+		std::ifstream fin(textFile);
+		if (!fin || !fin.good())
+			err("CompactCrs::fromText(): Could not open file " + textFile + "\n");
+
+		SizeType rows = 0;
+		SizeType cols = 0;
+		fin>>rows;
+		fin>>cols;
+		if (rows == 0 || rows != cols)
+			err("CompactCrs::fromText(): " + textFile + " must have rows==cols\n");
+
+		PsimagLite::CrsMatrix<ComplexType> matrix;
+		matrix.resize(rows, cols);
+		SizeType counter = 0;
+		for (SizeType i = 0; i < rows; ++i) {
+			matrix.setRow(i, counter);
+			for (SizeType j = 0; j < cols; ++j) {
+				ComplexType value = 0;
+				fin>>value;
+				if (value == ComplexType(0)) continue;
+				matrix.pushCol(j);
+				matrix.pushValue(value);
+				++counter;
+			}
+		}
+
+		if (!fin)
+			err("CompactCrs::fromText(): Could not read all entries of " + textFile + "\n");
+
+		matrix.setRow(rows, counter);
+		matrix.checkValidity();
+		MappedCrs::write(binaryFile, CompactCrs(matrix, true));
+	}
+
+private:
+
+	template<typename ValueType>
+	RealType expectation(const ValueType* values,
+	                     const VectorType& y,
+	                     SizeType start,
+	                     SizeType end) const
+	{
+		const SizeType* rowPtr = this->rowPtr();
+		const SizeType* col = this->col();
+		RealType e = 0;
+		if (!isUpper_) {
+			for (SizeType r = start; r < end; ++r) {
+				ComplexType row = 0;
+				for (SizeType k = rowPtr[r]; k < rowPtr[r + 1]; ++k)
+					row += values[k]*y[col[k]];
+
+				e += PsimagLite::real(PsimagLite::conj(y[r])*row);
+			}
+
+			return e;
+		}
+
+		for (SizeType r = start; r < end; ++r) {
+			ComplexType row = 0;
+			for (SizeType k = rowPtr[r]; k < rowPtr[r + 1]; ++k) {
+				const SizeType c = col[k];
+				if (c == r)
+					e += std::norm(y[r])*PsimagLite::real(values[k]);
+				else
+					row += values[k]*y[c];
+			}
+
+			e += 2*PsimagLite::real(PsimagLite::conj(y[r])*row);
+		}
+
+		return e;
+	}
+
+	template<typename ValueType>
+	void matrixVectorProduct(VectorType& x,
+	                         const VectorType& y,
+	                         const ValueType* values) const
+	{
+		const SizeType* rowPtr = this->rowPtr();
+		const SizeType* col = this->col();
+		for (SizeType r = 0; r < rows_; ++r) {
+			for (SizeType k = rowPtr[r]; k < rowPtr[r + 1]; ++k) {
+				const SizeType c = col[k];
+				x[r] += values[k]*y[c];
+				if (isUpper_ && c != r) x[c] += PsimagLite::conj(values[k])*y[r];
+			}
+		}
+	}
+
+	/* True if matrix is square, has the columns of each row sorted, and
+	   equals its conjugate transpose */
+	template<typename SparseMatrixType>
+	static bool isHermitian(const SparseMatrixType& matrix)
+	{
+		const SizeType rows = matrix.rows();
+		if (matrix.cols() != rows) return false;
+
+		for (SizeType r = 0; r < rows; ++r)
+			for (SizeType k = matrix.getRowPtr(r) + 1; k < matrix.getRowPtr(r + 1); ++k)
+				if (matrix.getCol(k) <= matrix.getCol(k - 1)) return false;
+
+		for (SizeType r = 0; r < rows; ++r) {
+			for (SizeType k = matrix.getRowPtr(r); k < matrix.getRowPtr(r + 1); ++k) {
+				const SizeType c = matrix.getCol(k);
+				const ComplexType value = matrix.getValue(k);
+				const ComplexType mirror = element(matrix, c, r);
+				if (std::abs(value - PsimagLite::conj(mirror)) > 1e-12) return false;
+			}
+		}
+
+		return true;
+	}
+
+	// matrix(r, c), for sorted columns
+	template<typename SparseMatrixType>
+	static ComplexType element(const SparseMatrixType& matrix, SizeType r, SizeType c)
+	{
+		SizeType lo = matrix.getRowPtr(r);
+		SizeType hi = matrix.getRowPtr(r + 1);
+		while (lo < hi) {
+			const SizeType mid = (lo + hi)/2;
+			if (matrix.getCol(mid) < c)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		return (lo < matrix.getRowPtr(r + 1) && matrix.getCol(lo) == c) ? matrix.getValue(lo)
+		                                                                 : ComplexType(0);
+	}
+
+	SizeType rows_;
+	bool isReal_;
+	bool isUpper_;
+	VectorSizeType rowPtr_;
+	VectorSizeType col_;
+	VectorRealType valuesReal_;
+	VectorType values_;
+	MappedCrsPointerType mapped_;
+}; // class CompactCrs
+
+} // namespace Gep
+#endif // COMPACTCRS_H
@@ -0,0 +1,213 @@
+#ifndef CONSTANTTUNER_H
+#define CONSTANTTUNER_H
+#include "Vector.h"
+#include "PsimagLite.h"
+
+namespace Gep {
+
+/* PSIDOC ConstantTuner
+The ConstantTuner class fits the defined constants, the ? symbols, of an individual
+to a batch of samples. It is used by the fitness classes of gep2 when the
+EngineOption tuneConstants is set, and only for individuals with a fitness of at
+least half the maximum fitness.
+Each pass of the tuner evaluates the individual on the whole batch once for the
+residuals, and once more per constant for the Jacobian by finite differences.
+It then solves the damped normal equations of the linear least-squares
+problem (Levenberg-Marquardt). Each residual is weighted by $1/\max(|t|, 1)$, where
+$t$ is the target. If the fitness improves, the tuned values are written back into
+the genome as parameters of the ? symbols, and are then inherited as any other symbol.
+*/
+template<typename ChromosomeType>
+class ConstantTuner {
+
+public:
+
+	typedef typename ChromosomeType::EvolutionType EvolutionType;
+	typedef typename ChromosomeType::ValueType RealType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef typename PsimagLite::Vector<VectorRealType>::Type VectorVectorRealType;
+
+	ConstantTuner(const EvolutionType& evolution, bool enabled)
+	    : evolution_(evolution), enabled_(enabled)
+	{}
+
+	bool enabled() const { return enabled_; }
+
+	/* Tunes the constants of chromosome, where inputs[i] are the inputs of
+	   sample i and targets[i] its target, and fitnessOf(c) is the fitness of c.
+	   Returns the new fitness, and changes chromosome only if it is better.
+	 */
+	template<typename FitnessFunctionType>
+	RealType operator()(const ChromosomeType& chromosome,
+	                    RealType fitness,
+	                    RealType maxFitness,
+	                    const VectorVectorRealType& inputs,
+	                    const VectorRealType& targets,
+	                    SizeType threadNum,
+	                    const FitnessFunctionType& fitnessOf) const
+	{
+		if (!enabled_ || fitness < 0.5*maxFitness) return fitness;
+
+		ChromosomeType work(chromosome.params(),
+		                    evolution_,
+		                    chromosome.genome(),
+		                    threadNum);
+		if (!fit(work, inputs, targets, threadNum)) return fitness;
+
+		ChromosomeType tuned(chromosome.params(),
+		                     evolution_,
+		                     work.genomeWithDcValues(),
+		                     threadNum);
+		const RealType newFitness = fitnessOf(tuned);
+		if (newFitness <= fitness) return fitness;
+
+		// see also GroundStateFitness::minimize
+		ChromosomeType* chromosomeNonconst = const_cast<ChromosomeType*>(&chromosome);
+		*chromosomeNonconst = tuned;
+		return newFitness;
+	}
+
+private:
+
+	// Returns true if the constants of chromosome were changed
+	bool fit(ChromosomeType& chromosome,
+	         const VectorVectorRealType& inputs,
+	         const VectorRealType& targets,
+	         SizeType threadNum) const
+	{
+		VectorRealType c = chromosome.dcValues();
+		const SizeType k = c.size();
+		const SizeType samples = targets.size();
+		if (k == 0 || samples == 0) return false;
+
+		VectorRealType r(samples);
+		RealType chi2 = residuals(r, chromosome, c, inputs, targets, threadNum);
+		if (chi2 != chi2) return false;
+
+		const RealType chi2Initial = chi2;
+		VectorVectorRealType jacobian(k, VectorRealType(samples));
+		VectorRealType rNew(samples);
+		VectorRealType cNew(k);
+		RealType lambda = 1e-3;
+		for (SizeType iter = 0; iter < iterations_; ++iter) {
+			for (SizeType p = 0; p < k; ++p) {
+				const RealType h = 1e-6*std::max(fabs(c[p]), static_cast<RealType>(1));
+				cNew = c;
+				cNew[p] += h;
+				residuals(rNew, chromosome, cNew, inputs, targets, threadNum);
+				for (SizeType i = 0; i < samples; ++i)
+					jacobian[p][i] = (rNew[i] - r[i])/h;
+			}
+
+			bool accepted = false;
+			bool converged = false;
+			while (!accepted && lambda < 1e10) {
+				if (!step(cNew, c, jacobian, r, lambda)) break;
+				const RealType chi2New = residuals(rNew, chromosome, cNew, inputs,
+				                                   targets, threadNum);
+				if (chi2New < chi2) {
+					accepted = true;
+					converged = (chi2 - chi2New < 1e-10*chi2);
+					c = cNew;
+					r = rNew;
+					chi2 = chi2New;
+					lambda *= 0.1;
+				} else {
+					lambda *= 10;
+				}
+			}
+
+			if (!accepted || converged) break;
+		}
+
+		chromosome.setDcValues(c);
+		return (chi2 < chi2Initial);
+	}
+
+	// Returns the sum of the squares of the weighted residuals r
+	RealType residuals(VectorRealType& r,
+	                   ChromosomeType& chromosome,
+	                   const VectorRealType& c,
+	                   const VectorVectorRealType& inputs,
+	                   const VectorRealType& targets,
+	                   SizeType threadNum) const
+	{
+		chromosome.setDcValues(c);
+		RealType sum = 0;
+		for (SizeType i = 0; i < targets.size(); ++i) {
+			evolution_.setInput(inputs[i], threadNum);
+			const RealType t = targets[i];
+			r[i] = (chromosome.exec(0) - t)/std::max(fabs(t), static_cast<RealType>(1));
+			sum += r[i]*r[i];
+		}
+
+		return sum;
+	}
+
+	// Solves (J^T J + lambda diag(J^T J)) (cNew - c) = -J^T r
+	static bool step(VectorRealType& cNew,
+	                 const VectorRealType& c,
+	                 const VectorVectorRealType& jacobian,
+	                 const VectorRealType& r,
+	                 RealType lambda)
+	{
+		const SizeType k = c.size();
+		const SizeType samples = r.size();
+		VectorVectorRealType a(k, VectorRealType(k + 1));
+		for (SizeType p = 0; p < k; ++p) {
+			for (SizeType q = p; q < k; ++q) {
+				RealType sum = 0;
+				for (SizeType i = 0; i < samples; ++i)
+					sum += jacobian[p][i]*jacobian[q][i];
+				a[p][q] = a[q][p] = sum;
+			}
+
+			RealType sum = 0;
+			for (SizeType i = 0; i < samples; ++i)
+				sum += jacobian[p][i]*r[i];
+			a[p][k] = -sum;
+		}
+
+		for (SizeType p = 0; p < k; ++p)
+			a[p][p] += lambda*a[p][p] + 1e-12;
+
+		// Gaussian elimination with partial pivoting
+		for (SizeType p = 0; p < k; ++p) {
+			SizeType pivot = p;
+			for (SizeType q = p + 1; q < k; ++q)
+				if (fabs(a[q][p]) > fabs(a[pivot][p])) pivot = q;
+
+			if (fabs(a[pivot][p]) < 1e-300) return false;
+			a[p].swap(a[pivot]);
+			for (SizeType q = p + 1; q < k; ++q) {
+				const RealType factor = a[q][p]/a[p][p];
+				for (SizeType j = p; j < k + 1; ++j)
+					a[q][j] -= factor*a[p][j];
+			}
+		}
+
+		cNew.resize(k);
+		for (SizeType p = k; p > 0; --p) {
+			RealType sum = a[p - 1][k];
+			for (SizeType j = p; j < k; ++j)
+				sum -= a[p - 1][j]*(cNew[j] - c[j]);
+			cNew[p - 1] = c[p - 1] + sum/a[p - 1][p - 1];
+		}
+
+		for (SizeType p = 0; p < k; ++p)
+			if (cNew[p] != cNew[p]) return false;
+
+		return true;
+	}
+
+	static const SizeType iterations_ = 10;
+
+	const EvolutionType& evolution_;
+	bool enabled_;
+}; // class ConstantTuner
+
+template<typename ChromosomeType>
+const SizeType ConstantTuner<ChromosomeType>::iterations_;
+
+} // namespace Gep
+#endif // CONSTANTTUNER_H
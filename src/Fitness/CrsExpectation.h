@@ -0,0 +1,69 @@
+#ifndef CRSEXPECTATION_H
+#define CRSEXPECTATION_H
+#include "Vector.h"
+#include "PsimagLite.h"
+#include "Parallelizer2.h"
+#include "Concurrency.h"
+
+namespace Gep {
+
+/* PSIDOC CrsExpectation
+The energy $\langle y|H|y\rangle$ of a Hamiltonian kept as a sparse matrix is
+computed row by row, as $\sum_r y_r^* \sum_c H_{rc}y_c$, without storing $H|y\rangle$,
+so that each row of $H$ and each entry of $y$ is read once. With
+HamiltonianThreads=$t$ larger than 1 in the input file, the rows of Hilbert
+spaces of at least 4096 states are split in $t$ blocks whose sums are computed in parallel;
+this helps when a few large circuits are evaluated one at a time, that is, with Threads=1.
+With Threads= larger than 1 the energy is already computed inside one of those threads,
+and HamiltonianThreads is ignored.
+*/
+template<typename SparseMatrixType, typename VectorType>
+class CrsExpectation {
+
+public:
+
+	typedef typename VectorType::value_type ComplexType;
+	typedef typename PsimagLite::Real<ComplexType>::Type RealType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+	CrsExpectation(SizeType threads)
+	    : threads_(std::max(threads, static_cast<SizeType>(1)))
+	{}
+
+	// <y|matrix|y>, where matrix.expectation(y, start, end) sums the rows in [start, end)
+	RealType operator()(const SparseMatrixType& matrix, const VectorType& y) const
+	{
+		const SizeType rows = matrix.rows();
+		assert(y.size() == rows);
+		const SizeType minRows = 4096;
+		// no threads within the threads of the engine
+		const SizeType threads = (PsimagLite::Concurrency::codeSectionParams.npthreads > 1)
+		        ? 1 : threads_;
+		if (threads == 1 || rows < minRows) return matrix.expectation(y, 0, rows);
+
+		const SizeType blockSize = (rows + threads - 1)/threads;
+		VectorRealType sums(threads, 0);
+		PsimagLite::CodeSectionParams codeParams(threads);
+		PsimagLite::Parallelizer2<> parallelizer2(codeParams);
+		parallelizer2.parallelFor(0,
+		                          threads,
+		                          [&sums, &matrix, &y, blockSize, rows](SizeType block,
+		                                                                SizeType) {
+			const SizeType start = block*blockSize;
+			sums[block] = matrix.expectation(y, start, std::min(start + blockSize, rows));
+		});
+
+		RealType e = 0;
+		for (SizeType block = 0; block < threads; ++block)
+			e += sums[block];
+
+		return e;
+	}
+
+private:
+
+	SizeType threads_;
+}; // class CrsExpectation
+
+} // namespace Gep
+#endif // CRSEXPECTATION_H
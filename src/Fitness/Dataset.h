@@ -0,0 +1,225 @@
+#ifndef DATASET_H
+#define DATASET_H
+#include "PsimagLite.h"
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdint>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace Gep {
+
+/* PSIDOC Dataset
+The Dataset class gives read-only access to training data stored in a binary
+columnar file, which is memory-mapped so that columns are used in place.
+The file starts with the 8 bytes \verb!EVDATA01!, followed by the number of
+rows and the number of columns as 64-bit unsigned integers, and then the
+columns one after the other, each one as rows doubles in native byte order.
+The last column is the target, and the others are the inputs 0, 1, ... in order.
+Use the program datasetFromCsv, or Dataset::fromCsv(), to convert a CSV file
+to this format.
+*/
+class Dataset {
+
+public:
+
+	typedef double RealType;
+	typedef PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Vector<VectorRealType>::Type VectorVectorRealType;
+	typedef std::uint64_t HeaderIntType;
+
+	Dataset(PsimagLite::String filename)
+	    : filename_(filename), fd_(-1), data_(nullptr), bytes_(0), rows_(0), cols_(0)
+	{
+		fd_ = open(filename_.c_str(), O_RDONLY);
+		if (fd_ < 0)
+			err("Dataset: Could not open file " + filename_ + "\n");
+
+		struct stat st;
+		if (fstat(fd_, &st) != 0 || static_cast<SizeType>(st.st_size) < headerSize()) {
+			close(fd_);
+			err("Dataset: File " + filename_ + " is too short\n");
+		}
+
+		bytes_ = st.st_size;
+		void* ptr = mmap(nullptr, bytes_, PROT_READ, MAP_PRIVATE, fd_, 0);
+		if (ptr == MAP_FAILED) {
+			close(fd_);
+			err("Dataset: Could not map file " + filename_ + "\n");
+		}
+
+		data_ = static_cast<const char*>(ptr);
+
+		// the destructor does not run if the constructor throws
+		try {
+			readHeader();
+		} catch (...) {
+			release();
+			throw;
+		}
+	}
+
+	~Dataset() { release(); }
+
+	SizeType rows() const { return rows_; }
+
+	SizeType columns() const { return cols_; }
+
+	// Rows values of column col, in place in the mapped file
+	const RealType* column(SizeType col) const
+	{
+		assert(col < cols_);
+		const RealType* ptr = reinterpret_cast<const RealType*>(data_ + headerSize());
+		return ptr + col*rows_;
+	}
+
+	const RealType* target() const { return column(cols_ - 1); }
+
+	// Hint that rows [start, start + n) will be needed soon
+	void willNeed(SizeType start, SizeType n) const
+	{
+		const long int page = sysconf(_SC_PAGESIZE);
+		for (SizeType col = 0; col < cols_; ++col) {
+			const char* begin = reinterpret_cast<const char*>(column(col) + start);
+			const char* aligned = data_ + ((begin - data_)/page)*page;
+			madvise(const_cast<char*>(aligned),
+			        (begin - aligned) + n*sizeof(RealType),
+			        MADV_WILLNEED);
+		}
+	}
+
+	// columns[j][i] is the value of column j at row i; the last column is the target
+	static void write(PsimagLite::String filename, const VectorVectorRealType& columns)
+	{
+		if (columns.size() < 2)
+			err("Dataset::write(): need at least one input and the target\n");
+
+		const HeaderIntType rows = columns[0].size();
+		const HeaderIntType cols = columns.size();
+		for (SizeType j = 1; j < cols; ++j)
+			if (columns[j].size() != rows)
+				err("Dataset::write(): columns of different lengths\n");
+
+		std::ofstream fout(filename, std::ios::binary);
+		if (!fout || !fout.good())
+			err("Dataset::write(): Could not open file " + filename + "\n");
+
+		fout.write(magic(), 8);
+		fout.write(reinterpret_cast<const char*>(&rows), sizeof(HeaderIntType));
+		fout.write(reinterpret_cast<const char*>(&cols), sizeof(HeaderIntType));
+		for (SizeType j = 0; j < cols; ++j)
+			fout.write(reinterpret_cast<const char*>(&columns[j][0]), rows*sizeof(RealType));
+
+		if (!fout.good())
+			err("Dataset::write(): Could not write file " + filename + "\n");
+	}
+
+	// Comma-separated rows; a first line that is not numeric is taken to be a header
+	static void fromCsv(PsimagLite::String csvFile, PsimagLite::String filename)
+	{
+		std::ifstream fin(csvFile);
+		if (!fin || !fin.good())
+			err("Dataset::fromCsv(): Could not open file " + csvFile + "\n");
+
+		VectorVectorRealType columns;
+		PsimagLite::String line;
+		SizeType lineNumber = 0;
+		VectorRealType row;
+		while (std::getline(fin, line)) {
+			++lineNumber;
+			if (line.length() > 0 && line[line.length() - 1] == '\r')
+				line.erase(line.length() - 1);
+
+			if (line.find_first_not_of(" \t") == PsimagLite::String::npos) continue;
+
+			const bool isNumeric = parseRow(row, line);
+			if (!isNumeric) {
+				if (lineNumber == 1) continue;
+				err("Dataset::fromCsv(): " + csvFile + ":" + ttos(lineNumber) +
+				    " is not a row of numbers\n");
+			}
+
+			if (columns.size() == 0) columns.resize(row.size());
+
+			if (row.size() != columns.size())
+				err("Dataset::fromCsv(): " + csvFile + ":" + ttos(lineNumber) +
+				    " has " + ttos(row.size()) + " columns instead of " +
+				    ttos(columns.size()) + "\n");
+
+			for (SizeType j = 0; j < row.size(); ++j)
+				columns[j].push_back(row[j]);
+		}
+
+		write(filename, columns);
+	}
+
+private:
+
+	Dataset(const Dataset&) = delete;
+
+	Dataset& operator=(const Dataset&) = delete;
+
+	// Unmaps and closes the file
+	void release()
+	{
+		if (data_) munmap(const_cast<char*>(data_), bytes_);
+		if (fd_ >= 0) close(fd_);
+		data_ = nullptr;
+		fd_ = -1;
+	}
+
+	static const char* magic() { return "EVDATA01"; }
+
+	static SizeType headerSize() { return 8 + 2*sizeof(HeaderIntType); }
+
+	void readHeader()
+	{
+		if (std::memcmp(data_, magic(), 8) != 0)
+			err("Dataset: File " + filename_ + " is not a dataset\n");
+
+		HeaderIntType rows = 0;
+		HeaderIntType cols = 0;
+		std::memcpy(&rows, data_ + 8, sizeof(HeaderIntType));
+		std::memcpy(&cols, data_ + 8 + sizeof(HeaderIntType), sizeof(HeaderIntType));
+		rows_ = rows;
+		cols_ = cols;
+		if (rows_ == 0 || cols_ < 2)
+			err("Dataset: File " + filename_ + " has no rows or no inputs\n");
+
+		// rows_*cols_ is compared by division, so that large headers cannot overflow it
+		const SizeType payload = bytes_ - headerSize();
+		const SizeType values = payload/sizeof(RealType);
+		if (payload % sizeof(RealType) != 0 || cols_ > values/rows_ || rows_*cols_ != values)
+			err("Dataset: File " + filename_ + " has the wrong size\n");
+	}
+
+	static bool parseRow(VectorRealType& row, const PsimagLite::String& line)
+	{
+		row.clear();
+		std::istringstream is(line);
+		PsimagLite::String field;
+		while (std::getline(is, field, ',')) {
+			const char* begin = field.c_str();
+			char* end = nullptr;
+			const RealType value = std::strtod(begin, &end);
+			if (end == begin) return false;
+			for (; *end != '\0'; ++end)
+				if (*end != ' ' && *end != '\t') return false;
+			row.push_back(value);
+		}
+
+		return (row.size() > 0);
+	}
+
+	PsimagLite::String filename_;
+	int fd_;
+	const char* data_;
+	SizeType bytes_;
+	SizeType rows_;
+	SizeType cols_;
+};
+}
+#endif // DATASET_H
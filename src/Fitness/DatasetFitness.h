@@ -0,0 +1,262 @@
+#ifndef DATASETFITNESS_H
+#define DATASETFITNESS_H
+#include "BaseFitness.h"
+#include "Dataset.h"
+#include "Concurrency.h"
+#include "ConstantTuner.h"
+#include <unordered_set>
+#include <algorithm>
+
+namespace Gep {
+
+struct DatasetFitnessParams {
+
+	DatasetFitnessParams(PsimagLite::String filename_,
+	                     SizeType batch_ = 0,
+	                     SizeType fullBatchAfter_ = 0,
+	                     bool tuneConstants_ = false)
+	    : filename(filename_),
+	      batch(batch_),
+	      fullBatchAfter(fullBatchAfter_),
+	      tuneConstants(tuneConstants_)
+	{}
+
+	PsimagLite::String filename;
+	SizeType batch;
+	SizeType fullBatchAfter;
+	bool tuneConstants;
+};
+
+/* PSIDOC DatasetFitness
+The DatasetFitness class fits the training data of a Dataset, so that
+the inputs of the individual are the input columns, and
+its output is compared to the last column.
+Each row contributes $1/(1 + |y - t|/\max(|t|, 1))$ to the fitness, where $y$ is
+the output and $t$ the target, and the sum is scaled so that the maximum fitness
+is the number of samples.
+If batch is not zero, generations before fullBatchAfter use only a mini-batch of batch
+rows drawn at random without replacement, which is the same for all individuals
+of the generation. The rows of the mini-batch are copied once per generation.
+The expression is evaluated a chunk of rows at a time, with input columns read
+in place from the mapped file, or from the copy of the mini-batch.
+With tuneConstants, the constants are fitted to the first rows of the (mini-)batch.
+*/
+template<typename ChromosomeType>
+class DatasetFitness : public BaseFitness<ChromosomeType> {
+
+public:
+
+	typedef BaseFitness<ChromosomeType> BaseType;
+	typedef DatasetFitnessParams FitnessParamsType;
+	typedef typename ChromosomeType::EvolutionType EvolutionType;
+	typedef typename ChromosomeType::TreeType TreeType;
+	typedef typename TreeType::NodeType NodeType;
+	typedef typename EvolutionType::PrimitivesType PrimitivesType;
+	typedef typename PrimitivesType::ValueType RealType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef typename PsimagLite::Vector<VectorRealType>::Type VectorVectorRealType;
+	typedef typename PsimagLite::Vector<VectorVectorRealType>::Type VectorVectorVectorRealType;
+	typedef ConstantTuner<ChromosomeType> ConstantTunerType;
+	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
+
+	DatasetFitness(SizeType samples, EvolutionType& evolution, FitnessParamsType* params)
+	    : samples_(samples),
+	      params_(checkParams(params)),
+	      dataset_(params_.filename),
+	      rows_(dataset_.rows()),
+	      buffers_(PsimagLite::Concurrency::codeSectionParams.npthreads),
+	      tuner_(evolution, params_.tuneConstants)
+	{
+		if (evolution.numberOfInputs() + 1 != dataset_.columns())
+			err("DatasetFitness::ctor(): " + params_.filename + " has " +
+			    ttos(dataset_.columns() - 1) + " inputs, but " +
+			    ttos(evolution.numberOfInputs()) + " inputs were given\n");
+	}
+
+	RealType getFitness(const ChromosomeType& chromosome,
+	                    long unsigned int,
+	                    SizeType threadNum)
+	{
+		const RealType sum = fitness(chromosome, threadNum);
+		if (!tuner_.enabled()) return sum;
+
+		const SizeType n = std::min(rows_, tuneRows_);
+		const SizeType inputs = dataset_.columns() - 1;
+		VectorVectorRealType x(n, VectorRealType(inputs));
+		VectorRealType t(n);
+		for (SizeType i = 0; i < n; ++i) {
+			for (SizeType j = 0; j < inputs; ++j)
+				x[i][j] = column(j)[i];
+			t[i] = target()[i];
+		}
+
+		auto fitnessOf = [this, threadNum](const ChromosomeType& c)
+		{
+			return fitness(c, threadNum);
+		};
+
+		return tuner_(chromosome, sum, maxFitness(), x, t, threadNum, fitnessOf);
+	}
+
+	RealType maxFitness() const { return samples_; }
+
+	void startGeneration(SizeType generation)
+	{
+		const SizeType total = dataset_.rows();
+		const bool fullBatch = (params_.batch == 0 ||
+		                        params_.batch >= total ||
+		                        generation >= params_.fullBatchAfter);
+		if (fullBatch) {
+			rows_ = total;
+			batch_.clear();
+			return;
+		}
+
+		rows_ = params_.batch;
+		VectorSizeType rows;
+		drawRows(rows, rows_, total);
+		const SizeType cols = dataset_.columns();
+		batch_.resize(cols);
+		for (SizeType j = 0; j < cols; ++j) {
+			const RealType* column = dataset_.column(j);
+			batch_[j].resize(rows_);
+			for (SizeType i = 0; i < rows_; ++i)
+				batch_[j][i] = column[rows[i]];
+		}
+	}
+
+	PsimagLite::String info(const ChromosomeType&) const
+	{
+		if (rows_ == dataset_.rows()) return "";
+		return "rows= " + ttos(rows_) + " of " + ttos(dataset_.rows());
+	}
+
+private:
+
+	RealType fitness(const ChromosomeType& chromosome, SizeType threadNum)
+	{
+		assert(threadNum < buffers_.size());
+		VectorVectorRealType& buffers = buffers_[threadNum];
+		buffers.resize(chromosome.effectiveSize() + 1);
+		VectorRealType& output = buffers[0];
+		output.resize(chunkSize_);
+
+		const TreeType& tree = chromosome.expression(0);
+		const RealType* target = this->target();
+		RealType sum = 0;
+		for (SizeType start = 0; start < rows_; start += chunkSize_) {
+			const SizeType n = std::min(chunkSize_, rows_ - start);
+			const RealType* y = execColumns(tree, start, n, &output[0], buffers, 1);
+			for (SizeType i = 0; i < n; ++i) {
+				const RealType t = target[start + i];
+				const RealType scale = std::max(fabs(t), static_cast<RealType>(1));
+				const RealType score = 1.0/(1.0 + fabs(y[i] - t)/scale);
+				if (score == score) sum += score; // NaN scores nothing
+			}
+		}
+
+		return sum*samples_/rows_;
+	}
+
+	// Column col of the rows in use, either in place or in the mini-batch
+	const RealType* column(SizeType col) const
+	{
+		if (batch_.size() == 0) return dataset_.column(col);
+		assert(col < batch_.size());
+		return &batch_[col][0];
+	}
+
+	const RealType* target() const { return column(dataset_.columns() - 1); }
+
+	// Draws n of the rows 0, 1, ..., total - 1 without replacement (Floyd),
+	// sorted so that the copy reads the columns in order
+	void drawRows(VectorSizeType& rows, SizeType n, SizeType total) const
+	{
+		assert(n <= total);
+		std::unordered_set<SizeType> drawn;
+		rows.clear();
+		for (SizeType j = total - n; j < total; ++j) {
+			SizeType t = static_cast<SizeType>(BaseType::rng()*(j + 1));
+			if (t > j) t = j;
+			if (!drawn.insert(t).second) {
+				drawn.insert(j);
+				t = j;
+			}
+
+			rows.push_back(t);
+		}
+
+		std::sort(rows.begin(), rows.end());
+	}
+
+	static const FitnessParamsType& checkParams(const FitnessParamsType* params)
+	{
+		if (!params)
+			err("DatasetFitness::ctor(): needs a dataset file\n");
+		return *params;
+	}
+
+	// Returns the outputs of tree for rows [start, start + n), either in place in
+	// the dataset for an input, or in dest; level is the first free buffer
+	const RealType* execColumns(const TreeType& tree,
+	                            SizeType start,
+	                            SizeType n,
+	                            RealType* dest,
+	                            VectorVectorRealType& buffers,
+	                            SizeType level) const
+	{
+		const NodeType& node = tree.node();
+		const SizeType arity = tree.descendants().size();
+		if (arity == 0) {
+			if (node.isInput())
+				return column(node.inputIndex()) + start;
+
+			const RealType value = tree.exec();
+			std::fill(dest, dest + n, value);
+			return dest;
+		}
+
+		assert(level + arity <= buffers.size());
+		typename PsimagLite::Vector<const RealType*>::Type args(arity);
+		for (SizeType j = 0; j < arity; ++j) {
+			VectorRealType& buffer = buffers[level + j];
+			buffer.resize(chunkSize_);
+			args[j] = execColumns(*tree.descendants()[j],
+			                      start,
+			                      n,
+			                      &buffer[0],
+			                      buffers,
+			                      level + arity);
+		}
+
+		VectorRealType values(arity);
+		for (SizeType i = 0; i < n; ++i) {
+			for (SizeType j = 0; j < arity; ++j)
+				values[j] = args[j][i];
+			dest[i] = node.exec(values);
+		}
+
+		return dest;
+	}
+
+	static const SizeType chunkSize_ = 1024;
+
+	static const SizeType tuneRows_ = 256;
+
+	SizeType samples_;
+	FitnessParamsType params_;
+	Dataset dataset_;
+	SizeType rows_;
+	VectorVectorRealType batch_;
+	VectorVectorVectorRealType buffers_;
+	ConstantTunerType tuner_;
+}; // class DatasetFitness
+
+template<typename ChromosomeType>
+const SizeType DatasetFitness<ChromosomeType>::chunkSize_;
+
+template<typename ChromosomeType>
+const SizeType DatasetFitness<ChromosomeType>::tuneRows_;
+
+} // namespace Gep
+#endif // DATASETFITNESS_H
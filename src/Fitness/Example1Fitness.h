@@ -17,24 +17,25 @@ along with evendim. If not, see <http://www.gnu.org/licenses/>.
 */
 #ifndef EXAMPLE_1_FITNESS_H
 #define EXAMPLE_1_FITNESS_H
-#include "BaseFitness.h"
+#include "ExampleFitnessBase.h"
 
 namespace Gep {
 
 template<typename ChromosomeType>
-class Example1Fitness : public BaseFitness<ChromosomeType> {
+class Example1Fitness : public ExampleFitnessBase<ChromosomeType> {
 
 public:
 
-	typedef BaseFitness<ChromosomeType> BaseType;
+	typedef ExampleFitnessBase<ChromosomeType> BaseType;
 	typedef typename BaseType::FitnessParamsType FitnessParamsType;
-	typedef typename ChromosomeType::EvolutionType EvolutionType;
-	typedef typename EvolutionType::PrimitivesType PrimitivesType;
-	typedef typename PrimitivesType::ValueType RealType;
-	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
-
-	Example1Fitness(SizeType samples, EvolutionType& evolution, FitnessParamsType*)
-	    : samples_(samples),evolution_(evolution)
+	typedef typename BaseType::EvolutionType EvolutionType;
+	typedef typename BaseType::RealType RealType;
+	typedef typename BaseType::VectorRealType VectorRealType;
+	typedef typename BaseType::RandomType RandomType;
+
+	Example1Fitness(SizeType samples, EvolutionType& evolution, FitnessParamsType* params)
+	    : BaseType(samples, evolution, params),
+	      samples_(samples)
 	{
 		if (evolution.numberOfInputs() != 1) {
 			throw PsimagLite::RuntimeError("Example1Fitness::ctor(): 1 input expected\n");
@@ -44,46 +45,21 @@ public:
 			samples_[i] = BaseType::rng() * 2.0 - 1.0;
 	}
 
-	RealType getFitness(const ChromosomeType& chromosome,
-	                    long unsigned int seed,
-	                    SizeType threadNum)
-	{
-		if (threadNum > 0)
-			err("Threading not supported yet (sorry)\n");
-
-		bool verbose = evolution_.verbose();
-		RealType sum = 0;
-
-		PsimagLite::MersenneTwister rng(seed);
-		for (SizeType i = 0; i < maxFitness(); i++) {
-			bool b = true; //(evolution_.rng() < 0.5) ? true : false;
-			RealType r = rng() * 10.0 - 10.0;
-			RealType x = (b) ? r : samples_[i];
-			samples_[i] = r;
-			RealType fOfX = f(x);
-			evolution_.setInput(0, x, threadNum);
-
-			if (verbose) evolution_.printInputs(std::cout);
-
-			RealType tmp = fabs((chromosome.exec(0)-fOfX)/fOfX);
+private:
 
-			sum += (1.0 - fabs(tmp));
-		}
-		return sum;
+	RealType drawSample(VectorRealType& x, const RandomType& random) const
+	{
+		x[0] = random() * 10.0 - 10.0;
+		return f(x[0]);
 	}
 
-	RealType maxFitness() const { return samples_.size(); }
-
-private:
-
-	RealType f(const RealType& x)
+	RealType f(const RealType& x) const
 	{
 		RealType tmp = x * (x - 1) * (x + 1);
 		return tmp;
 	}
 
 	VectorRealType samples_;
-	EvolutionType& evolution_;
 }; // class Example1Fitness
 
 } // namespace Gep
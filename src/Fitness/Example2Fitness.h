@@ -17,55 +17,40 @@ along with evendim. If not, see <http://www.gnu.org/licenses/>.
 */
 #ifndef EXAMPLE_2_FITNESS_H
 #define EXAMPLE_2_FITNESS_H
-#include "BaseFitness.h"
+#include "ExampleFitnessBase.h"
 
 namespace Gep {
 
 template<typename ChromosomeType>
-class Example2Fitness : public BaseFitness<ChromosomeType> {
+class Example2Fitness : public ExampleFitnessBase<ChromosomeType> {
 
 public:
 
-	typedef BaseFitness<ChromosomeType> BaseType;
+	typedef ExampleFitnessBase<ChromosomeType> BaseType;
 	typedef typename BaseType::FitnessParamsType FitnessParamsType;
-	typedef typename ChromosomeType::EvolutionType EvolutionType;
-	typedef typename EvolutionType::PrimitivesType PrimitivesType;
-	typedef typename PrimitivesType::ValueType RealType;
-	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef typename BaseType::EvolutionType EvolutionType;
+	typedef typename BaseType::RealType RealType;
+	typedef typename BaseType::VectorRealType VectorRealType;
+	typedef typename BaseType::RandomType RandomType;
 
-	Example2Fitness(SizeType samples, EvolutionType& evolution, FitnessParamsType*)
-	    : samples_(samples),evolution_(evolution)
+	Example2Fitness(SizeType samples, EvolutionType& evolution, FitnessParamsType* params)
+	    : BaseType(samples, evolution, params)
 	{
 		if (evolution.numberOfInputs() != 1) {
 			throw PsimagLite::RuntimeError("Example2Fitness::ctor(): 1 input expected\n");
 		}
 	}
 
-	RealType getFitness(const ChromosomeType& chromosome,
-	                    unsigned long int seed,
-	                    SizeType threadNum)
-	{
-		bool verbose = evolution_.verbose();
-		RealType sum = 0;
-		PsimagLite::MersenneTwister rng(seed);
-		for (SizeType i = 0; i < maxFitness(); i++) {
-			SizeType x = static_cast<SizeType>(rng()*1000);
-			RealType fOfX = f(x);
-			evolution_.setInput(0, x, threadNum);
-			if (verbose) evolution_.printInputs(std::cout);
-
-			RealType tmp = fabs((chromosome.exec(0)-fOfX)/fOfX);
+private:
 
-			sum += (1.0 - fabs(tmp));
-		}
-		return sum;
+	RealType drawSample(VectorRealType& x, const RandomType& random) const
+	{
+		SizeType n = static_cast<SizeType>(random()*1000);
+		x[0] = n;
+		return f(n);
 	}
 
-	RealType maxFitness() const { return samples_; }
-
-private:
-
-	RealType f(const SizeType& x)
+	RealType f(const SizeType& x) const
 	{
 		if (x<4) return 1;
 
@@ -77,9 +62,6 @@ private:
 
 		return 1;
 	}
-
-	SizeType samples_;
-	EvolutionType& evolution_;
 }; // class Example2Fitness
 
 } // namespace Gep
@@ -17,7 +17,7 @@ along with evendim. If not, see <http://www.gnu.org/licenses/>.
 */
 #ifndef EXAMPLE_3_FITNESS_H
 #define EXAMPLE_3_FITNESS_H
-#include "BaseFitness.h"
+#include "ExampleFitnessBase.h"
 #include "Vector.h"
 
 namespace Gep {
@@ -32,22 +32,22 @@ namespace Gep {
  then the function returns -1.
  */
 template<typename ChromosomeType>
-class Example3Fitness : public BaseFitness<ChromosomeType> {
+class Example3Fitness : public ExampleFitnessBase<ChromosomeType> {
 
 	static const SizeType stringLength_ = 6;
 
 public:
 
-	typedef BaseFitness<ChromosomeType> BaseType;
+	typedef ExampleFitnessBase<ChromosomeType> BaseType;
 	typedef typename BaseType::FitnessParamsType FitnessParamsType;
-	typedef typename ChromosomeType::EvolutionType EvolutionType;
-	typedef typename EvolutionType::PrimitivesType PrimitivesType;
-	typedef typename PrimitivesType::ValueType RealType;
-	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef typename BaseType::EvolutionType EvolutionType;
+	typedef typename BaseType::RealType RealType;
+	typedef typename BaseType::VectorRealType VectorRealType;
+	typedef typename BaseType::RandomType RandomType;
 	typedef typename PsimagLite::Vector<SizeType>::Type VectorSizeType;
 
-	Example3Fitness(SizeType samples, const EvolutionType& evolution, FitnessParamsType*)
-	    : samples_(samples),evolution_(evolution)
+	Example3Fitness(SizeType samples, const EvolutionType& evolution, FitnessParamsType* params)
+	    : BaseType(samples, evolution, params)
 	{
 		if (evolution.numberOfInputs() != stringLength_) {
 			throw PsimagLite::RuntimeError("Example3Fitness::ctor(): " +
@@ -55,36 +55,26 @@ public:
 		}
 	}
 
-	RealType getFitness(const ChromosomeType& chromosome,
-	                    long unsigned int,
-	                    SizeType threadNum)
-	{
-		if (threadNum > 0)
-			err("Threading not supported yet (sorry)\n");
-
-		bool verbose = evolution_.verbose();
-		RealType sum = 0;
-
-		VectorRealType r(stringLength_);
-		for (SizeType i = 0; i < samples_; i++) {
-			for (SizeType j = 0; j < stringLength_; ++j)
-				r[j] = static_cast<SizeType>(128*evolution_.rng());
-
-			evolution_.setInput(r);
-
-			if (verbose) evolution_.printInputs(std::cout);
-			RealType fOfX = f(r);
-			RealType tmp = fabs((chromosome.exec(0)-fOfX)/fOfX);
+private:
 
-			sum += (1.0 - fabs(tmp));
-		}
+	// A single thread keeps drawing from the evolution's generator
+	// so that its results are as before; threads use their seed
+	RandomType random(PsimagLite::MersenneTwister& rng) const
+	{
+		if (PsimagLite::Concurrency::codeSectionParams.npthreads != 1)
+			return BaseType::random(rng);
 
-		return sum;
+		const EvolutionType& evolution = BaseType::evolution();
+		return [&evolution]() { return evolution.rng(); };
 	}
 
-	RealType maxFitness() const { return samples_; }
+	RealType drawSample(VectorRealType& x, const RandomType& random) const
+	{
+		for (SizeType j = 0; j < stringLength_; ++j)
+			x[j] = static_cast<SizeType>(128*random());
 
-private:
+		return f(x);
+	}
 
 	RealType f(const VectorRealType& r) const
 	{
@@ -94,9 +84,6 @@ private:
 
 		return sum;
 	}
-
-	SizeType samples_;
-	const EvolutionType& evolution_;
 }; // class Example3Fitness
 
 } // namespace Gep
@@ -0,0 +1,141 @@
+#ifndef EXAMPLEFITNESSBASE_H
+#define EXAMPLEFITNESSBASE_H
+#include "BaseFitness.h"
+#include "ExampleFitnessParams.h"
+#include "SubtreeCache.h"
+#include "ConstantTuner.h"
+#include <functional>
+
+namespace Gep {
+
+/* The part of the example fitnesses of gep2 that does not depend on the
+   function to fit: each sample adds 1 - |relative error| to the fitness.
+   With the subtree cache all individuals of a generation share the samples
+   drawn by startGeneration(); without it each individual gets its own, and
+   its constants may be tuned to them. The derived class draws the samples */
+template<typename ChromosomeType>
+class ExampleFitnessBase : public BaseFitness<ChromosomeType> {
+
+public:
+
+	typedef BaseFitness<ChromosomeType> BaseType;
+	typedef ExampleFitnessParams FitnessParamsType;
+	typedef typename ChromosomeType::EvolutionType EvolutionType;
+	typedef typename EvolutionType::PrimitivesType PrimitivesType;
+	typedef typename PrimitivesType::ValueType RealType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef typename PsimagLite::Vector<VectorRealType>::Type VectorVectorRealType;
+	typedef SubtreeCache<typename ChromosomeType::TreeType> SubtreeCacheType;
+	typedef ConstantTuner<ChromosomeType> ConstantTunerType;
+	typedef std::function<RealType()> RandomType;
+
+	ExampleFitnessBase(SizeType samples,
+	                   const EvolutionType& evolution,
+	                   FitnessParamsType* params)
+	    : samples_(samples),
+	      evolution_(evolution),
+	      useCache_(params && params->subtreeCache),
+	      tuner_(evolution, params && params->tuneConstants)
+	{}
+
+	RealType getFitness(const ChromosomeType& chromosome,
+	                    long unsigned int seed,
+	                    SizeType threadNum)
+	{
+		if (useCache_) return cachedFitness(chromosome);
+
+		VectorVectorRealType inputs;
+		VectorRealType fOfX;
+		PsimagLite::MersenneTwister rng(seed);
+		drawSamples(inputs, fOfX, random(rng));
+
+		const RealType sum = fitness(chromosome, inputs, fOfX, threadNum);
+		auto fitnessOf = [this, &inputs, &fOfX, threadNum](const ChromosomeType& c)
+		{
+			return fitness(c, inputs, fOfX, threadNum);
+		};
+
+		return tuner_(chromosome, sum, maxFitness(), inputs, fOfX, threadNum, fitnessOf);
+	}
+
+	RealType maxFitness() const { return samples_; }
+
+	void startGeneration(SizeType)
+	{
+		if (!useCache_) return;
+
+		VectorVectorRealType inputs;
+		drawSamples(inputs, fOfX_, [this]() { return BaseType::rng(); });
+		cache_.setBatch(inputs);
+	}
+
+protected:
+
+	// Fills x, the inputs of one sample, with random(), and returns f(x)
+	virtual RealType drawSample(VectorRealType& x, const RandomType& random) const = 0;
+
+	// The random numbers for the samples of getFitness(), given rng seeded for it
+	virtual RandomType random(PsimagLite::MersenneTwister& rng) const
+	{
+		return [&rng]() { return rng(); };
+	}
+
+	const EvolutionType& evolution() const { return evolution_; }
+
+	void drawSamples(VectorVectorRealType& inputs,
+	                 VectorRealType& fOfX,
+	                 const RandomType& random) const
+	{
+		inputs.assign(samples_, VectorRealType(evolution_.numberOfInputs()));
+		fOfX.resize(samples_);
+		for (SizeType i = 0; i < samples_; ++i)
+			fOfX[i] = drawSample(inputs[i], random);
+	}
+
+	RealType fitness(const ChromosomeType& chromosome,
+	                 const VectorVectorRealType& inputs,
+	                 const VectorRealType& fOfX,
+	                 SizeType threadNum) const
+	{
+		bool verbose = evolution_.verbose();
+		RealType sum = 0;
+		for (SizeType i = 0; i < fOfX.size(); i++) {
+			evolution_.setInput(inputs[i], threadNum);
+
+			if (verbose) evolution_.printInputs(std::cout, threadNum);
+
+			RealType tmp = fabs((chromosome.exec(0)-fOfX[i])/fOfX[i]);
+
+			sum += (1.0 - fabs(tmp));
+		}
+
+		return sum;
+	}
+
+	// fitness() on the samples of startGeneration(), through the subtree cache
+	RealType cachedFitness(const ChromosomeType& chromosome)
+	{
+		const VectorRealType& values = cache_(chromosome.expression(0));
+		const SizeType n = values.size();
+		assert(n == fOfX_.size());
+		RealType sum = 0;
+		for (SizeType i = 0; i < n; ++i) {
+			RealType tmp = fabs((values[i] - fOfX_[i])/fOfX_[i]);
+			sum += (1.0 - fabs(tmp));
+		}
+
+		return sum;
+	}
+
+private:
+
+	SizeType samples_;
+	const EvolutionType& evolution_;
+	bool useCache_;
+	VectorRealType fOfX_;
+	SubtreeCacheType cache_;
+	ConstantTunerType tuner_;
+}; // class ExampleFitnessBase
+
+} // namespace Gep
+#endif // EXAMPLEFITNESSBASE_H
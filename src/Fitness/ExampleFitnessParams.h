@@ -0,0 +1,18 @@
+#ifndef EXAMPLEFITNESSPARAMS_H
+#define EXAMPLEFITNESSPARAMS_H
+#include "Options.h"
+
+namespace Gep {
+
+struct ExampleFitnessParams {
+
+	ExampleFitnessParams(const Options& options)
+	    : subtreeCache(options.isSet("subtreeCache")),
+	      tuneConstants(options.isSet("tuneConstants"))
+	{}
+
+	bool subtreeCache;
+	bool tuneConstants;
+};
+}
+#endif // EXAMPLEFITNESSPARAMS_H
@@ -0,0 +1,82 @@
+#ifndef FIDELITYSCHEDULE_H
+#define FIDELITYSCHEDULE_H
+#include "Vector.h"
+#include "PsimagLite.h"
+#include "Concurrency.h"
+
+namespace Gep {
+
+/* PSIDOC FidelitySchedule
+With MinimizerFidelity=$f_0$, for $0<f_0<1$, in the input file, the minimizations of
+the first generation use the fraction $f_0$ of MinimizerMaxIterations, and a tolerance
+MinimizerTolerance$/f_0$, because the early circuits are poor and do not need
+tight angles to be told apart. The fidelity $f$ then rises geometrically to 1 in
+MinimizerFidelityGenerations steps, which defaults to 10, taking one step per
+generation, and one more step for each generation that does not improve the best
+fitness at the fidelity of the schedule. The engine evaluates the individuals that can be
+selected again at full fidelity before it selects and prints them, and drops the others;
+see Engine::selectBest.
+*/
+template<typename RealType>
+class FidelitySchedule {
+
+public:
+
+	FidelitySchedule(RealType start, SizeType generations)
+	    : start_(start),
+	      generations_(std::max(generations, static_cast<SizeType>(1))),
+	      step_(0),
+	      full_(false),
+	      best_(-1e50),
+	      bests_(PsimagLite::Concurrency::codeSectionParams.npthreads, -1e50)
+	{}
+
+	bool enabled() const { return (start_ > 0 && start_ < 1); }
+
+	// The fidelity of this generation, 1 once the schedule completes
+	RealType operator()() const
+	{
+		if (full_ || !enabled() || step_ >= generations_) return 1;
+		return pow(start_, 1 - static_cast<RealType>(step_)/generations_);
+	}
+
+	void setFull(bool full) { full_ = full; }
+
+	// Records the fitness of an evaluation at the fidelity of the schedule
+	void record(SizeType threadNum, RealType fitness)
+	{
+		if (full_) return;
+
+		assert(threadNum < bests_.size());
+		bests_[threadNum] = std::max(bests_[threadNum], fitness);
+	}
+
+	void startGeneration()
+	{
+		if (!enabled()) return;
+
+		RealType best = -1e50;
+		for (SizeType i = 0; i < bests_.size(); ++i)
+			best = std::max(best, bests_[i]);
+
+		// nothing evaluated yet
+		if (best == -1e50) return;
+
+		// a plateau tightens the schedule twice as fast
+		if (best <= best_) ++step_;
+		best_ = std::max(best_, best);
+		++step_;
+	}
+
+private:
+
+	RealType start_;
+	SizeType generations_;
+	SizeType step_;
+	bool full_;
+	RealType best_;
+	typename PsimagLite::Vector<RealType>::Type bests_;
+}; // class FidelitySchedule
+
+} // namespace Gep
+#endif // FIDELITYSCHEDULE_H
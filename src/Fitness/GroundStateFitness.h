@@ -24,6 +24,14 @@ along with evendim. If not, see <http://www.gnu.org/licenses/>.
 #include "MersenneTwister.h"
 #include "GroundStateParams.h"
 #include "Hamiltonian.h"
+#include "PreparedCircuit.h"
+#include "Lbfgs.h"
+#include "Rotosolve.h"
+#include "CmaEs.h"
+#include "MultiStart.h"
+#include "AngleInheritance.h"
+#include "FidelitySchedule.h"
+#include "Parallelizer2.h"
 
 namespace Gep {
 
@@ -35,10 +43,14 @@ public:
 	typedef typename PsimagLite::Vector<ComplexType>::Type VectorType;
 	typedef typename PsimagLite::Real<ComplexType>::Type RealType;
 	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef typename PsimagLite::Vector<VectorRealType>::Type VectorVectorRealType;
 	typedef RealType FieldType;
 	typedef typename ChromosomeType::VectorStringType VectorStringType;
 	typedef PsimagLite::Matrix<ComplexType> MatrixType;
 	typedef typename EvolutionType::NodeFactoryType NodeFactoryType;
+	typedef PreparedCircuit<ChromosomeType> PreparedCircuitType;
+	typedef typename PsimagLite::Vector<PreparedCircuitType>::Type VectorPreparedCircuitType;
+	typedef typename PsimagLite::Vector<VectorType>::Type VectorVectorType;
 
 	enum class FunctionEnum {FITNESS, DIFFERENCE};
 
@@ -49,11 +61,10 @@ public:
 	    : evolution_(evolution),
 	      chromosome_(chromosome),
 	      groundStateParams_(groundStateParams),
-	      outVector_(groundStateParams_.inVector.size()),
+	      circuit_(chromosome),
+	      numberOfAngles_(circuit_.size()),
 	      threadNum_(thread)
-	{
-		numberOfAngles_ = findNumberOfAngles(chromosome.effectiveVecString());
-	}
+	{}
 
 	SizeType size() const { return numberOfAngles_; }
 
@@ -69,234 +80,117 @@ public:
 		return fitness(&angles, FunctionEnum::DIFFERENCE, false);
 	}
 
+	// Gradient of the energy by the adjoint method, see PreparedCircuit
 	void df(VectorRealType& dest, const VectorRealType& angles)
 	{
-		VectorStringType vecStr = chromosome_.vecString();
-		encodeAngles(vecStr, angles);
-		const ChromosomeType* chromosome = new ChromosomeType(chromosome_.params(),
-		                                                      evolution_,
-		                                                      vecStr,
-		                                                      threadNum_);
-
-		dest.resize(angles.size());
+		circuit_.bind(angles);
 		evolution_.setInput(0, groundStateParams_.inVector, threadNum_);
+		const VectorType psi = chromosome_.exec(0);
 
-		const VectorType& inVector = groundStateParams_.inVector;
-		for (SizeType angleIndex = 0; angleIndex < numberOfAngles_; ++angleIndex) {
-			evolution_.setInput(0, inVector, threadNum_);
+		// d<psi|H|psi> = 2 Re<H psi|dpsi>, and the leak energy adds -2g Re<psi|dpsi>
+		groundStateParams_.hamiltonian.matrixVectorProduct(work_, psi);
+		const RealType g = groundStateParams_.hamiltonian.leakPenalty();
+		const SizeType n = work_.size();
+		for (SizeType i = 0; i < n; ++i) {
+			if (g != 0) work_[i] -= g*psi[i];
+			work_[i] *= 2;
+		}
 
-			computeDifferentialVector(differential_, angles, angleIndex);
+		dest.resize(angles.size());
+		std::fill(dest.begin(), dest.end(), 0);
 
-			const RealType tmp = diffVectorDiff2(chromosome->exec(0),
-			                                     outVector_,
-			                                     differential_);
-			dest[angleIndex] += tmp;
-		}
+		// gates that sent weight out of the sector cannot be undone on psi
+		if (groundStateParams_.hamiltonian.leakEnergy(psi) > 0)
+			circuit_.gradientFromInput(dest, groundStateParams_.inVector, work_);
+		else
+			circuit_.gradient(dest, psi, work_);
 	}
 
 	RealType fitness(const VectorRealType* angles, FunctionEnum functionEnum, bool verbose)
 	{
-		const ChromosomeType* chromosome = nullptr;
-
-		VectorStringType vecStr = chromosome_.vecString();
-
-		if (angles) {
-			encodeAngles(vecStr, *angles);
-			chromosome = new ChromosomeType(chromosome_.params(),
-			                                evolution_,
-			                                vecStr,
-			                                threadNum_);
-		} else {
-			chromosome = &chromosome_;
-		}
+		if (angles) circuit_.bind(*angles);
 
 		evolution_.setInput(0, groundStateParams_.inVector, threadNum_);
 		if (verbose) evolution_.printInputs(std::cout);
 
 		// oracle goes here
-		RealType e = groundStateParams_.hamiltonian.energy(chromosome->exec(0), threadNum_);
-
-		if (angles) {
-			delete chromosome;
-			chromosome = nullptr;
-		}
+		RealType e = groundStateParams_.hamiltonian.energy(chromosome_.exec(0), threadNum_);
 
 		return (functionEnum == FunctionEnum::DIFFERENCE) ? e : -e;
 	}
 
-	static void encodeAngles(VectorStringType& vecStr, const VectorRealType& angles)
+	// The genome of the individual with these angles
+	PackedGenome genome(const VectorRealType& angles) const
 	{
-		const SizeType n = vecStr.size();
-		SizeType currentIndex = 0;
-		bool flag = true;
-		for (SizeType i = 0; i < n; ++i) {
-
-			if (isInputGate(vecStr[i])) {
-				flag = false;
-				continue;
-			}
-
-			if (numberOfAnglesOneGate(vecStr[i]) == 0 || !flag) continue;
-			PsimagLite::String str = vecStr[i];
-			str = NodeFactoryType::stripPreviousAngleIfAny(str);
-			if (angles.size() < currentIndex)
-				err("encodeAngles: too many angles for rotations in this individual!?\n");
-			str += ":" + ttos(angles[currentIndex++]);
-			vecStr[i] = str;
-		}
-
-		if (currentIndex != angles.size())
-			err("encodeAngles: too few angles for rotations in this individual!?\n");
+		return circuit_.genome(angles);
 	}
 
-	static void initAngles(VectorRealType& angles,
-	                       const VectorStringType& vStr,
-	                       long unsigned int seed)
-	{
-		const SizeType n = vStr.size();
-		SizeType currentIndex = 0;
-		PsimagLite::MersenneTwister rng(seed);
-		for (SizeType i = 0; i < n; ++i) {
-			if (numberOfAnglesOneGate(vStr[i]) == 0) continue;
-			if (angles.size() < currentIndex)
-				err("initAngles: too few angles for individual\n");
+	PsimagLite::String signature() const { return circuit_.signature(); }
 
-			initAngle(angles[currentIndex++], vStr[i], rng);
-		}
+	const PreparedCircuitType& circuit() const { return circuit_; }
 
-		if (angles.size() != currentIndex)
-			err("initAngles: too many angles for individual\n");
-	}
+	const VectorType& inVector() const { return groundStateParams_.inVector; }
 
-private:
-
-	template<typename SomeRngType>
-	static void initAngle(RealType& angle,
-	                      PsimagLite::String str,
-	                      SomeRngType& rng)
+	// <a|H|b>
+	ComplexType expectation(const VectorType& a, const VectorType& b)
 	{
-		typename PsimagLite::String::const_iterator it = std::find(str.begin(),
-		                                                           str.end(),
-		                                                           ':');
-		if (it == str.end()) {
-			angle = 2*M_PI*rng();
-			return;
-		}
-
-		PsimagLite::String angleStr = str.substr(it - str.begin() + 1, str.end() - it - 1);
-		angle = std::stod(angleStr);
+		groundStateParams_.hamiltonian.matrixVectorProduct(work_, b);
+		return a*work_; // does conjugation of first vector
 	}
 
-	static SizeType findNumberOfAngles(const VectorStringType& vstr)
+	/* The energies of a batch of vectors of angles, computed by threads threads,
+	   each with its own copy of the circuit; by one thread if this already runs in one
+	   of the threads of the engine, as threads within threads would oversubscribe cores */
+	void energies(VectorRealType& values, const VectorVectorRealType& batch, SizeType threads)
 	{
-		SizeType n = vstr.size();
-
-		SizeType count = 0;
-		for (SizeType i = 0; i < n; ++i) {
-			count += numberOfAnglesOneGate(vstr[i]);
+		if (PsimagLite::Concurrency::codeSectionParams.npthreads > 1) threads = 1;
+
+		if (copies_.size() != threads) {
+			copies_.clear();
+			copies_.reserve(threads);
+			for (SizeType i = 0; i < threads; ++i)
+				copies_.push_back(circuit_);
+			psis_.resize(threads);
+			works_.resize(threads);
 		}
 
-		return count;
+		values.resize(batch.size());
+		PsimagLite::CodeSectionParams codeParams(threads);
+		PsimagLite::Parallelizer2<> parallelizer2(codeParams);
+		parallelizer2.parallelFor(0,
+		                          batch.size(),
+		                          [&values, &batch, this](SizeType i, SizeType threadNum) {
+			const PreparedCircuitType& circuit = copies_[threadNum];
+			VectorType& psi = psis_[threadNum];
+			psi = groundStateParams_.inVector;
+			circuit.bind(batch[i]);
+			circuit.apply(psi, 0, circuit.gates());
+			groundStateParams_.hamiltonian.matrixVectorProduct(works_[threadNum], psi);
+			values[i] = PsimagLite::real(psi*works_[threadNum]) +
+			        groundStateParams_.hamiltonian.leakEnergy(psi);
+		});
 	}
 
-	static SizeType numberOfAnglesOneGate(PsimagLite::String str)
-	{
-		if (str.length() == 0) return 0;
-		return (str[0] == 'R' || str.substr(0, 2) == "PG") ? 1 : 0;
-	}
+	bool isPeriodic(SizeType index) const { return circuit_.isRotation(index); }
 
-	static bool isInputGate(PsimagLite::String str)
+	SizeType initAngles(VectorRealType& angles, long unsigned int seed) const
 	{
-		if (str.length() == 0) return false;
-		return (str[0] == '0') ? true : false;
-	}
-
-	static RealType vectorDiff2(const VectorType& v1, const VectorType& v2)
-	{
-		const SizeType n = v1.size();
-		assert(n == v2.size());
-		RealType sum = 0;
-		for (SizeType i = 0; i < n; ++i)
-			sum += std::abs(v2[i] - v1[i]);
-
-		return sum/n;
-	}
-
-	static RealType diffVectorDiff2(const VectorType& v1,
-	                                const VectorType& v2,
-	                                const VectorType& v3)
-	{
-		const SizeType n = v1.size();
-		assert(n == v2.size());
-		assert(n == v3.size());
-		RealType sum = 0;
-		for (SizeType i = 0; i < n; ++i) {
-			RealType denom = std::abs(v2[i] - v1[i]);
-			if (denom == 0) denom = 1;
-			const RealType re1 = PsimagLite::real(v2[i] - v1[i]);
-			const RealType im1 = PsimagLite::imag(v2[i] - v1[i]);
-			sum += (PsimagLite::real(v3[i])*re1 + PsimagLite::imag(v3[i])*im1)/denom;
-		}
-
-		return sum/n;
-	}
-
-	void computeDifferentialVector(VectorType& differential,
-	                               const VectorRealType& angles,
-	                               SizeType angleIndex)
-	{
-		differential.resize(angles.size());
-		std::fill(differential.begin(), differential.end(), 0);
-
-		assert(angles.size() == numberOfAngles_);
-
-		VectorStringType cString = chromosome_.effectiveVecString();
-
-		VectorStringType tmpString = replaceOneR(cString, angleIndex, chromosome_.vecString(0).size());
-
-		assert(tmpString.size() == chromosome_.vecString(0).size());
-
-		// create derivative individual angle-th
-		ChromosomeType newChromosome(chromosome_.params(), evolution_, tmpString, threadNum_);
-
-		// apply to inVector
-		evolution_.setInput(0, groundStateParams_.inVector, threadNum_);
-		differential = newChromosome.exec(0);
+		PsimagLite::MersenneTwister rng(seed);
+		return circuit_.initAngles(angles, rng);
 	}
 
-	// adds padding as well
-	VectorStringType replaceOneR(VectorStringType& v, SizeType angleIndex, SizeType fullLength)
-	{
-		VectorStringType w(fullLength);
-
-		const SizeType n = v.size();
-		assert(n <= fullLength);
-		SizeType count = 0;
-		for (SizeType i = 0; i < n; ++i) {
-			w[i] = v[i];
-			SizeType m = numberOfAnglesOneGate(v[i]);
-			if (m == 0) continue;
-			if (m == 1) {
-				if (count++ == angleIndex)
-					w[i] = "_" + v[i];
-			}
-		}
-
-		assert(count == numberOfAngles_);
-
-		for (SizeType i = n; i < fullLength; ++i)
-			w[i] = "0";
-
-		return w;
-	}
+private:
 
 	EvolutionType& evolution_;
 	const ChromosomeType& chromosome_;
 	const GroundStateParamsType& groundStateParams_;
+	PreparedCircuitType circuit_;
 	SizeType numberOfAngles_;
-	VectorType outVector_;
-	VectorType differential_;
+	VectorType work_;
 	SizeType threadNum_;
+	VectorPreparedCircuitType copies_;
+	VectorVectorType psis_;
+	VectorVectorType works_;
 };
 
 /* PSIDOC GroundStateFitnessClass
@@ -325,12 +219,24 @@ public:
 	typedef typename GroundStateParamsType::MinimizerParamsType MinimizerParamsType;
 
 	typedef GroundStateParamsType FitnessParamsType;
+	typedef FunctionToMinimize2<ChromosomeType, EvolutionType, GroundStateParamsType>
+	        FunctionToMinimizeType;
+	typedef typename PsimagLite::Minimizer<RealType, FunctionToMinimizeType> MinimizerType;
+	typedef Lbfgs<FunctionToMinimizeType> LbfgsType;
+	typedef LbfgsWarmStart<typename LbfgsType::PairsType> LbfgsWarmStartType;
+	typedef Rotosolve<FunctionToMinimizeType> RotosolveType;
+	typedef CmaEs<FunctionToMinimizeType> CmaEsType;
+	typedef MultiStart<FunctionToMinimizeType> MultiStartType;
+	typedef FidelitySchedule<RealType> FidelityScheduleType;
 
 	GroundStateFitness(SizeType samples,
 	                  EvolutionType& evolution,
 	                  FitnessParamsType* fitParams)
 	    : evolution_(evolution),
-	      fitParams_(*fitParams)
+	      fitParams_(*fitParams),
+	      schedule_(fitParams->minParams.fidelity, fitParams->minParams.fidelityGenerations),
+	      resume_(false),
+	      budget_(1)
 	{
 		if (evolution.numberOfInputs() != 1)
 			err("QuantumOracle::ctor(): 1 input expected\n");
@@ -345,11 +251,6 @@ public:
 	                    long unsigned int seed,
 	                    SizeType threadNum)
 	{
-		typedef FunctionToMinimize2<ChromosomeType, EvolutionType, GroundStateParamsType>
-		        FunctionToMinimizeType;
-		typedef typename PsimagLite::Minimizer<RealType, FunctionToMinimizeType> MinimizerType;
-		typedef typename ChromosomeType::VectorStringType VectorStringType;
-
 		evolution_.setInput(0, fitParams_.inVector, threadNum);
 
 		RealType norma = PsimagLite::norm(fitParams_.inVector);
@@ -364,40 +265,37 @@ public:
 		}
 
 		const MinimizerParamsType& minParams = fitParams_.minParams;
-		MinimizerType min(f, minParams.maxIter, minParams.verbose);
-
-		int used = 0;
 		VectorRealType angles(f.size());
-		FunctionToMinimizeType::initAngles(angles, chromosome.effectiveVecString(), seed);
-		if (minParams.algo == MinimizerParamsType::SIMPLEX) {
-			used = min.simplex(angles,
-			                   minParams.delta,
-			                   minParams.tol);
-		} else if (minParams.algo == MinimizerParamsType::NONE) {
-			used = 1;
-		} else {
-			used = min.conjugateGradient(angles,
-			                             minParams.delta,
-			                             minParams.delta2,
-			                             minParams.tol,
-			                             minParams.saveEvery);
-		}
-
-		int status = (min.status() == MinimizerType::GSL_SUCCESS) ? 0 : 1;
-
-		if (status == 0) {
-			VectorStringType vecStr = chromosome.vecString();
-			FunctionToMinimizeType::encodeAngles(vecStr, angles);
-			const ChromosomeType* chromosome2 = new ChromosomeType(chromosome.params(),
-			                                                       evolution_,
-			                                                       vecStr,
-			                                                       threadNum);
+		const SizeType inherited = f.initAngles(angles, seed);
+		if (evolution_.angleGrid() > 0) return gridFitness(f, angles, threadNum);
+
+		// resumed rounds of a race go on from the best start so far
+		MultiStartType multiStart(f, (resume_) ? 1 : minParams.starts);
+		bool converged = false;
+		int used = multiStart(converged,
+		                      angles,
+		                      maxIter(),
+		                      seed + 1, // not the seed of initAngles
+		                      [&f, seed, threadNum, this](bool& convergedOne,
+		                                                  VectorRealType& x,
+		                                                  SizeType iterations) {
+			return minimize(convergedOne, x, f, iterations, seed, threadNum);
+		});
+
+		int status = (converged) ? 0 : 1;
+		if (minParams.inheritAngles && !inheritance_.isMinimized(chromosome.genome()))
+			inheritance_.add(threadNum, inherited, angles.size(), used);
+
+		// rounds of a race keep their angles, to be resumed by the next round
+		if (status == 0 || resume_ || budget_ < 1 || minParams.inheritAngles) {
+			const ChromosomeType chromosome2(chromosome.params(),
+			                                 evolution_,
+			                                 f.genome(angles),
+			                                 threadNum);
+			if (minParams.inheritAngles) inheritance_.minimized(chromosome2.genome());
 
 			ChromosomeType* chromosomeNonconst = const_cast<ChromosomeType*>(&chromosome);
-			*chromosomeNonconst = *chromosome2;
-
-			delete chromosome2;
-			chromosome2 = nullptr;
+			*chromosomeNonconst = chromosome2;
 		}
 
 		const bool printFooter = minParams.verbose;
@@ -406,11 +304,12 @@ public:
 		RealType value = f.fitness(&angles,
 		                           FunctionToMinimizeType::FunctionEnum::FITNESS,
 		                           evolution_.verbose());
+		schedule_.record(threadNum, value);
 
 		if (!printFooter) return value; // <--- EARLY EXIT HERE
 
 		std::cerr<<"QuantumOracle::minimize(): ";
-		if (min.status() == MinimizerType::GSL_SUCCESS) {
+		if (converged) {
 			std::cerr<<" converged after ";
 		} else {
 			std::cerr<<"NOT CONVERGED after ";
@@ -424,6 +323,29 @@ public:
 
 	RealType maxFitness() const { return 100; }
 
+	void startGeneration(SizeType generation)
+	{
+		warmStart_.startGeneration();
+		if (fitParams_.minParams.inheritAngles && generation > 0)
+			inheritance_.print(std::cerr, generation - 1);
+
+		inheritance_.startGeneration();
+
+		schedule_.startGeneration();
+	}
+
+	RealType fidelity() const { return schedule_(); }
+
+	void setFullFidelity(bool full) { schedule_.setFull(full); }
+
+	RealType racingBudget() const { return fitParams_.minParams.racing; }
+
+	void setRacingRound(SizeType round, RealType budget)
+	{
+		resume_ = (round > 0);
+		budget_ = budget;
+	}
+
 	PsimagLite::String info(const ChromosomeType& chromosome) const
 	{
 		SizeType threadNum = 0;
@@ -442,8 +364,89 @@ private:
 		return str;
 	}
 
+	// Angles on a grid are not minimized; see AngleGrid
+	RealType gridFitness(FunctionToMinimizeType& f, VectorRealType& angles, SizeType threadNum)
+	{
+		for (SizeType i = 0; i < angles.size(); ++i)
+			angles[i] = evolution_.nearestGridAngle(angles[i]);
+
+		const RealType value = f.fitness(&angles,
+		                                 FunctionToMinimizeType::FunctionEnum::FITNESS,
+		                                 evolution_.verbose());
+		schedule_.record(threadNum, value);
+		return value;
+	}
+
+	// The iterations that the minimizer may use in this round of racing, at this fidelity
+	SizeType maxIter() const
+	{
+		const RealType iterations = fitParams_.minParams.maxIter*budget_*schedule_();
+		return std::max(static_cast<SizeType>(iterations + 0.5), static_cast<SizeType>(1));
+	}
+
+	RealType tol() const { return fitParams_.minParams.tol/schedule_(); }
+
+	// Minimizes angles with up to maxIter iterations, and returns the iterations used
+	int minimize(bool& converged,
+	             VectorRealType& angles,
+	             FunctionToMinimizeType& f,
+	             SizeType maxIter,
+	             long unsigned int seed,
+	             SizeType threadNum)
+	{
+		const MinimizerParamsType& minParams = fitParams_.minParams;
+		if (minParams.algo == MinimizerParamsType::LBFGS)
+			return LbfgsType::minimize(converged,
+			                           angles,
+			                           f,
+			                           maxIter,
+			                           tol(),
+			                           minParams,
+			                           warmStart_,
+			                           threadNum);
+
+		if (minParams.algo == MinimizerParamsType::ROTOSOLVE) {
+			RotosolveType rotosolve(f, maxIter, minParams.verbose);
+			const int used = rotosolve.minimize(angles);
+			converged = rotosolve.converged();
+			return used;
+		}
+
+		if (minParams.algo == MinimizerParamsType::CMAES) {
+			CmaEsType cmaEs(f, maxIter, minParams.threads, minParams.verbose);
+			PsimagLite::MersenneTwister rng(seed);
+			const int used = cmaEs.minimize(angles, minParams.delta, tol(), rng);
+			converged = cmaEs.converged();
+			return used;
+		}
+
+		MinimizerType min(f, maxIter, minParams.verbose);
+		int used = 0;
+		if (minParams.algo == MinimizerParamsType::SIMPLEX) {
+			used = min.simplex(angles,
+			                   minParams.delta,
+			                   tol());
+		} else if (minParams.algo == MinimizerParamsType::NONE) {
+			used = 1;
+		} else {
+			used = min.conjugateGradient(angles,
+			                             minParams.delta,
+			                             minParams.delta2,
+			                             tol(),
+			                             minParams.saveEvery);
+		}
+
+		converged = (min.status() == MinimizerType::GSL_SUCCESS);
+		return used;
+	}
+
 	EvolutionType& evolution_;
 	const GroundStateParamsType fitParams_;
+	LbfgsWarmStartType warmStart_;
+	AngleInheritance inheritance_;
+	FidelityScheduleType schedule_;
+	bool resume_;
+	RealType budget_;
 }; // class QuantumOracle
 } // namespace Gep
 
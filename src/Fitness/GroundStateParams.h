@@ -29,6 +29,10 @@ struct GroundStateParams {
 			err("Initial vector has " + ttos(inVector.size()) +
 			    " entries, but I was expecting " + ttos(hilbert) + "\n");
 
+		hamiltonian.sector().compress(inVector, "Initial vector");
+		// Rotosolve's closed form needs circuits that keep the norm
+		if (hamiltonian.sector().isActive() && minParams.algo == MinimizerParamsType::ROTOSOLVE)
+			err("Rotosolve cannot be used with SymmetrySector\n");
 	}
 
 	MinimizerParamsType minParams;
@@ -6,6 +6,11 @@
 #include "CrsMatrix.h"
 #include "HamiltonianFromExpression.h"
 #include "IsingGraph.hh"
+#include "PauliSum.h"
+#include "LanczosGroundState.h"
+#include "CompactCrs.h"
+#include "CrsExpectation.h"
+#include "SymmetrySector.h"
 
 namespace Gep {
 
@@ -15,7 +20,7 @@ class Hamiltonian {
 
 public:
 
-	enum class TypeEnum {FILE, XX, EXPRESSION, ISING_GRAPH};
+	enum class TypeEnum {FILE, XX, EXPRESSION, ISING_GRAPH, PAULI_SUM};
 
 	typedef PsimagLite::InputNg<InputCheck> InputNgType;
 	typedef typename PsimagLite::Vector<ComplexType>::Type VectorType;
@@ -28,24 +33,161 @@ public:
 	typedef PsimagLite::CrsMatrix<ComplexType> SparseMatrixType;
 	typedef HamiltonianFromExpression<ComplexType> HamiltonianFromExpressionType;
 	typedef IsingGraph<ComplexType> IsingGraphType;
+	typedef typename HamiltonianFromExpressionType::PauliSumType PauliSumType;
+	typedef LanczosGroundState<ComplexType> LanczosGroundStateType;
+	typedef CompactCrs<ComplexType> CompactCrsType;
+	typedef CrsExpectation<CompactCrsType, VectorType> CrsExpectationType;
 
 	Hamiltonian(typename InputNgType::Readable& io, SizeType numberOfThreads)
 	    : hamTipo(TypeEnum::XX),
 	      bits_(0),
 	      periodic_(false),
 	      isingGraph_(nullptr),
+	      pauliSum_(0),
 	      needsTransformAndTruncate_(false),
-	      cacheVector_(numberOfThreads)
+	      printGroundState_(1),
+	      groundStateEnergy_(0),
+	      penalty_(0),
+	      expectation_(1)
 	{
 		io.readline(bits_, "NumberOfBits="); // == number of "sites"
 
+		PsimagLite::String sector;
+		try {
+			io.readline(sector, "SymmetrySector=");
+		} catch (std::exception&) {}
+
+		sector_ = SymmetrySector(sector, bits_);
+
+		try {
+			io.readline(printGroundState_, "HamiltonianPrintGroundState=");
+		} catch (std::exception&) {}
+
+		fill(io, numberOfThreads);
+		fillCompact(io);
+		findGroundState(io);
+	}
+
+	RealType energy(const VectorType& y, SizeType threadNum) const
+	{
+		switch (hamTipo) {
+		case  TypeEnum::ISING_GRAPH: {
+			assert(isingGraph_);
+			return isingGraph_->energyZZ(y);
+			break;
+		}
+
+		case TypeEnum::PAULI_SUM:
+			return pauliSum_.energy(y);
+			break;
+
+		default: {
+			// leakEnergy() is 0 without a sector
+			if (reducedBasis_.size() == 0) return energyMatrix(y) + leakEnergy(y);
+
+			return energyMatrix(gather(y));
+			break;
+		}
+
+		}
+	}
+
+	// x = H*y
+	void matrixVectorProduct(VectorType& x, const VectorType& y) const
+	{
+		x.resize(y.size());
+		std::fill(x.begin(), x.end(), 0);
+		if (hamTipo == TypeEnum::ISING_GRAPH) {
+			assert(isingGraph_);
+			isingGraph_->matrixVectorProduct(x, y);
+			return;
+		}
+
+		if (hamTipo == TypeEnum::PAULI_SUM) {
+			pauliSum_.matrixVectorProduct(x, y);
+			return;
+		}
+
+		if (reducedBasis_.size() == 0) {
+			matrixVectorProductMatrix(x, y);
+			return;
+		}
+
+		VectorType xReduced(reducedBasis_.size(), 0);
+		matrixVectorProductMatrix(xReduced, gather(y));
+		for (SizeType i = 0; i < reducedBasis_.size(); ++i)
+			x[reducedBasis_[i]] = xReduced[i];
+	}
+
+	// should be private
+	static PsimagLite::String info(const VectorType& v,
+	                               double epsilon,
+	                               const SymmetrySector& sector)
+	{
+		const SizeType n = v.size();
+		PsimagLite::String buffer;
+		for (SizeType i = 0; i < n; ++i) {
+			if (std::norm(v[i]) > epsilon) buffer += ttos(sector.state(i)) + " ";
+		}
+
+		return buffer;
+	}
+
+	/* The states of the output of chromosome, the weight it lost out of the
+	   symmetry sector, if any, and, if HamiltonianPrintGroundState=2,
+	   its energy over the ground state energy, and its overlap with the ground state */
+	template<typename SomeChromosomeType>
+	PsimagLite::String info(const SomeChromosomeType& chromosome) const
+	{
+		const VectorType psi = chromosome.exec(0);
+		PsimagLite::String buffer = info(psi, 1e-4, sector_);
+		if (sector_.isActive()) {
+			const RealType leak = 1 - PsimagLite::real(psi*psi);
+			if (leak > 1e-8) buffer += "leak= " + ttos(leak) + " ";
+		}
+
+		if (printGroundState_ < 2) return buffer;
+
+		const RealType ratio = energy(psi, 0)/groundStateEnergy_;
+		const RealType overlap = std::norm(groundState_*psi);
+		return buffer + "ratio= " + ttos(ratio) + " overlap= " + ttos(overlap) + " ";
+	}
+
+	// The exact ground state energy, if HamiltonianPrintGroundState= is not 0
+	RealType groundStateEnergy() const { return groundStateEnergy_; }
+
+	// The states the Hamiltonian acts on; see SymmetrySector
+	const SymmetrySector& sector() const { return sector_; }
+
+	// g in the energy g(1 - <y|y>) of the weight lost out of the sector, or 0
+	RealType leakPenalty() const { return penalty_; }
+
+	// g(1 - <y|y>), or 0 without a sector
+	RealType leakEnergy(const VectorType& y) const
+	{
+		if (!sector_.isActive()) return 0;
+
+		return penalty_*(1 - PsimagLite::real(y*y));
+	}
+
+private:
+
+	void fill(typename InputNgType::Readable& io, SizeType numberOfThreads)
+	{
 		PsimagLite::String ham;
 		io.readline(ham, "Hamiltonian=");
 		if (ham.substr(0, 5) == "file:") {
+			const PsimagLite::String filename = ham.substr(5, ham.length() - 5);
+			hamTipo = TypeEnum::FILE;
+			if (MappedCrs::isBinary(filename)) {
+				if (sector_.isActive())
+					err("SymmetrySector cannot be used with the binary matrix " + filename + "\n");
 
-			fillFromFile(ham.substr(5, ham.length() - 5), io);
+				fillFromBinary(filename, io);
+				return;
+			}
 
-			hamTipo = TypeEnum::FILE;
+			fillFromFile(filename, io);
 
 			SizeType hilbert = (1 << bits_);
 
@@ -55,7 +197,8 @@ public:
 
 			assert(isHermitian(matrix_, true));
 
-			allocateCacheVector(hilbert);
+			restrictToSector();
+			findDiagonal();
 
 			return;
 		}
@@ -74,6 +217,9 @@ public:
 		} catch (std::exception&) {}
 
 		if (ham == "IsingGraph" || ham == "zz") {
+			if (sector_.isActive())
+				err("SymmetrySector cannot be used with Hamiltonian=" + ham + "\n");
+
 			PsimagLite::String graphFile = "zz";
 			if (ham == "IsingGraph") {
 
@@ -89,147 +235,229 @@ public:
 			return;
 		}
 
-		if (ham == "xx") {
-			hamTipo = TypeEnum::XX;
-			fillHxx(coupling);
+		int matrixFree = 0;
+		try {
+			io.readline(matrixFree, "HamiltonianMatrixFree=");
+		} catch (std::exception&) {}
+
+		// xx, zxz and expressions are built from their Pauli sums
+		fillPauliSum(ham, coupling, io);
+		pauliSum_.groupTerms();
+		if (matrixFree > 0) {
+			if (sector_.isActive())
+				err("SymmetrySector cannot be used with HamiltonianMatrixFree=1\n");
+
+			hamTipo = TypeEnum::PAULI_SUM;
 			return; // EARLY EXIT HERE
 		}
 
-		if (ham == "zxz") {
-			PsimagLite::String strZxZ = createNnn("Sz", "Sx", "Sz", bits_);
-			HamiltonianFromExpressionType hamZxZ(strZxZ, bits_);
-			const SparseMatrixType& matrixZxZ = hamZxZ.getMatrix();
+		pauliSum_.fillCrs(matrix_, numberOfThreads, sector_);
+		pauliSum_ = PauliSumType(bits_);
 
-			PsimagLite::String strX = createLocal("Sx", bits_);
-			HamiltonianFromExpressionType hamX(strX, bits_);
-			const SparseMatrixType& matrixX = hamX.getMatrix();
+		findDiagonal();
+		hamTipo = (ham == "xx") ? TypeEnum::XX : TypeEnum::EXPRESSION;
+	}
 
-			PsimagLite::String strXx = createNn("Sx", "Sx", bits_);
-			HamiltonianFromExpressionType hamXx(strXx, bits_);
-			const SparseMatrixType& matrixXx = hamXx.getMatrix();
+	/* Moves matrix_ to compact_, unless it is diagonal, keeping only its upper
+	   triangle if it is Hermitian and HamiltonianHermitian= is 1, or if it is
+	   not given and the space is large. HamiltonianThreads= splits the energy
+	   of large matrices among threads when Threads=1 */
+	void fillCompact(typename InputNgType::Readable& io)
+	{
+		int threads = 1;
+		try {
+			io.readline(threads, "HamiltonianThreads=");
+		} catch (std::exception&) {}
 
-			RealType hJ = 0;
-			io.readline(hJ, "HamiltonianJ=");
-			matrix_ = hJ*matrixZxZ;
+		if (threads < 1) err("HamiltonianThreads= must be at least 1\n");
+		expectation_ = CrsExpectationType(threads);
 
-			RealType h1 = 0;
-			io.readline(h1, "Hamiltonianh1=");
-			addMatrixWithWeight(matrix_, h1, matrixX);
+		int hermitian = -1;
+		try {
+			io.readline(hermitian, "HamiltonianHermitian=");
+		} catch (std::exception&) {}
 
-			RealType h2 = 0;
-			io.readline(h2, "Hamiltonianh2=");
-			addMatrixWithWeight(matrix_, h2, matrixXx);
+		if (sector_.isActive()) findPenalty();
 
-		} else {
-			std::cerr<<"Asumming Hamiltonian Expression\n";
-			HamiltonianFromExpressionType hamExpression(ham, bits_);
-			matrix_ = hamExpression.getMatrix();
+		if (matrix_.rows() > 0 && diagonal_.size() == 0) {
+			const SizeType minUpperRows = 4096;
+			const SizeType rows = matrix_.rows(); // of the reduced basis or the sector, if any
+			const bool upper = (hermitian > 0 || (hermitian < 0 && rows >= minUpperRows));
+			compact_ = CompactCrsType(matrix_, upper);
+			if (hermitian > 0 && !compact_.isUpper())
+				err("HamiltonianHermitian=1 but the Hamiltonian is not Hermitian\n");
 		}
 
-		assert(cacheVector_.size() > 0);
-		allocateCacheVector(matrix_.rows());
-		hamTipo = TypeEnum::EXPRESSION;
-		HamiltonianFromExpressionType::solveIt(matrix_);
+		matrix_.clear();
 	}
 
-	RealType energy(const VectorType& y, SizeType threadNum) const
+	/* Finds the exact ground state, if HamiltonianPrintGroundState= is 1, the
+	   default, except for Ising Hamiltonians, or if it is 2, and prints it.
+	   HamiltonianGroundStateFile= names a file that keeps the ground state
+	   between runs */
+	void findGroundState(typename InputNgType::Readable& io)
 	{
-		switch (hamTipo) {
-		case  TypeEnum::ISING_GRAPH: {
-			assert(isingGraph_);
-			return isingGraph_->energyZZ(y);
-			break;
-		}
+		if (printGroundState_ == 0) return;
+		if (hamTipo == TypeEnum::ISING_GRAPH && printGroundState_ < 2) return;
 
-		default: {
-			assert(cacheVector_.size() > threadNum);
-			assert(cacheVector_[threadNum].size() == matrix_.rows());
-			std::fill(cacheVector_[threadNum].begin(), cacheVector_[threadNum].end(), 0);
-
-			matrix_.matrixVectorProduct(cacheVector_[threadNum], y);
+		PsimagLite::String file;
+		try {
+			io.readline(file, "HamiltonianGroundStateFile=");
+		} catch (std::exception&) {}
 
-			return PsimagLite::real(y*cacheVector_[threadNum]); // does conjugation of first vector
-			break;
+		if (file == "" || !readGroundState(file)) {
+			computeGroundState();
+			if (file != "") writeGroundState(file);
 		}
 
+		printGroundState();
+	}
+
+	void computeGroundState()
+	{
+		const SizeType hilbert = sector_.size();
+		const SizeType maxDenseRows = 1024;
+		const bool hasMatrix = (hamTipo == TypeEnum::FILE ||
+		                        hamTipo == TypeEnum::XX ||
+		                        hamTipo == TypeEnum::EXPRESSION);
+		if (hasMatrix && hilbert <= maxDenseRows) {
+			PsimagLite::Matrix<ComplexType> a = denseMatrix();
+			VectorRealType eigs(hilbert);
+			diag(a, eigs, 'V');
+			groundStateEnergy_ = eigs[0];
+			groundState_.resize(hilbert);
+			for (SizeType i = 0; i < hilbert; ++i)
+				groundState_[i] = a(i, 0);
+			return;
 		}
+
+		const SizeType maxSteps = 500;
+		LanczosGroundStateType lanczos(maxSteps, 1e-12);
+		groundStateEnergy_ = lanczos(groundState_, *this, hilbert);
 	}
 
-	// should be private
-	static PsimagLite::String info(const VectorType& v, double epsilon)
+	// The matrix in the full space
+	PsimagLite::Matrix<ComplexType> denseMatrix() const
 	{
-		const SizeType n = v.size();
-		PsimagLite::String buffer;
-		for (SizeType i = 0; i < n; ++i) {
-			if (std::norm(v[i]) > epsilon) buffer += ttos(i) + " ";
+		PsimagLite::Matrix<ComplexType> a;
+		if (diagonal_.size() == 0) {
+			a = compact_.toDense();
+		} else {
+			const SizeType n = diagonal_.size();
+			a.resize(n, n);
+			for (SizeType i = 0; i < n; ++i)
+				a(i, i) = diagonal_[i];
 		}
 
-		return buffer;
+		const SizeType n = reducedBasis_.size();
+		if (n == 0) return a;
+
+		const SizeType hilbert = (1 << bits_);
+		PsimagLite::Matrix<ComplexType> full(hilbert, hilbert);
+		for (SizeType i = 0; i < n; ++i)
+			for (SizeType j = 0; j < n; ++j)
+				full(reducedBasis_[i], reducedBasis_[j]) = a(i, j);
+
+		return full;
 	}
 
-	template<typename SomeChromosomeType>
-	PsimagLite::String info(const SomeChromosomeType& chromosome) const
+	bool readGroundState(PsimagLite::String file)
 	{
-		return info(chromosome.exec(0), 1e-4);
+		std::ifstream fin(file);
+		if (!fin || !fin.good()) return false;
+
+		SizeType rows = 0;
+		fin>>rows;
+		if (rows != sector_.size()) {
+			std::cerr<<"Ignoring "<<file<<": it has "<<rows<<" rows\n";
+			return false;
+		}
+
+		fin>>groundStateEnergy_;
+		groundState_.resize(rows);
+		for (SizeType i = 0; i < rows; ++i)
+			fin>>groundState_[i];
+
+		if (!fin.good()) err("Could not read ground state from " + file + "\n");
+
+		std::cerr<<"Ground state read from "<<file<<"\n";
+		return true;
 	}
 
-private:
+	void writeGroundState(PsimagLite::String file) const
+	{
+		std::ofstream fout(file);
+		if (!fout || !fout.good())
+			err("Could not write ground state to " + file + "\n");
+
+		fout.precision(17);
+		fout<<groundState_.size()<<" "<<groundStateEnergy_<<"\n";
+		for (SizeType i = 0; i < groundState_.size(); ++i)
+			fout<<groundState_[i]<<"\n";
+	}
 
-	void fillHxx(RealType coupling)
+	void printGroundState() const
 	{
-		SizeType hilbertSpace = (1 << bits_);
-		matrix_.resize(hilbertSpace, hilbertSpace);
-		allocateCacheVector(hilbertSpace);
+		if (hamTipo != TypeEnum::XX && hamTipo != TypeEnum::FILE) {
+			std::cout<<"gs energy="<<groundStateEnergy_<<"\n";
+			return;
+		}
 
-		VectorRealType v(hilbertSpace);
-		VectorBoolType bcol(hilbertSpace);
+		std::cout<<"Ground State Energy="<<groundStateEnergy_<<"\n";
+		if (hamTipo == TypeEnum::XX) return;
 
-		SizeType counter = 0;
-		for (SizeType i = 0; i < hilbertSpace; ++i) {
-			matrix_.setRow(i, counter);
-			std::fill(v.begin(), v.end(), 0);
-			std::fill(bcol.begin(), bcol.end(), false);
-			for (SizeType site = 0; site < bits_; ++site) {
-				// Flip bit at site
-				SizeType maskSite = (1 << site);
-				SizeType j = i ^ maskSite;
-				SizeType site2 = site + 1;
-				if (site2 >= bits_ && !periodic_) continue;
-				assert(site2 <= bits_);
-				if (site2 == bits_) site2 = 0;
-				SizeType maskSite2 = (1 << site2);
-				j ^= maskSite2;
-				v[j] += coupling;
-				bcol[j] = true;
-			}
+		std::cout<<"Eigenvector------------\n";
+		ComplexType sum = 0;
+		for (SizeType i = 0; i < groundState_.size(); ++i) {
+			ComplexType val = groundState_[i];
+			sum += val*PsimagLite::conj(val);
+			if (std::norm(val) < 1e-8)
+				continue;
 
-			counter += fillThisRow(v, bcol);
+			std::cout<<sector_.state(i)<<" "<<val<<"\n";
 		}
 
-		matrix_.setRow(hilbertSpace, counter);
-		matrix_.checkValidity();
-
-		VectorRealType eigs(hilbertSpace);
-		PsimagLite::Matrix<ComplexType> a = matrix_.toDense();
-		diag(a, eigs, 'V');
-		std::cout<<"Ground State Energy="<<eigs[0]<<"\n";
+		std::cout<<"-------- End eigenvector="<<sum<<"\n\n";
 	}
 
-	SizeType fillThisRow(VectorRealType& v, VectorBoolType& bcols)
+	void fillPauliSum(PsimagLite::String ham,
+	                  RealType coupling,
+	                  typename InputNgType::Readable& io)
 	{
-		const SizeType hilbertSpace = v.size();
-		assert(hilbertSpace == bcols.size());
-		SizeType counter = 0;
-		for (SizeType i = 0; i < hilbertSpace; ++i) {
-			if (!bcols[i]) continue;
-			matrix_.pushCol(i);
-			matrix_.pushValue(v[i]);
-			++counter;
-			bcols[i] = false;
-			v[i] = 0;
+		if (ham == "xx") {
+			PsimagLite::String strXx = createNn("Sx", "Sx", bits_);
+			if (periodic_) strXx += "+Sx" + ttos(bits_ - 1) + "*Sx0";
+			pauliSum_ = HamiltonianFromExpressionType(strXx, bits_, false).getPauliSum();
+			pauliSum_ *= coupling;
+			return;
 		}
 
-		return counter;
+		if (ham == "zxz") {
+			PsimagLite::String strZxZ = createNnn("Sz", "Sx", "Sz", bits_);
+			PsimagLite::String strX = createLocal("Sx", bits_);
+			PsimagLite::String strXx = createNn("Sx", "Sx", bits_);
+
+			RealType hJ = 0;
+			io.readline(hJ, "HamiltonianJ=");
+			pauliSum_ = HamiltonianFromExpressionType(strZxZ, bits_, false).getPauliSum();
+			pauliSum_ *= hJ;
+
+			RealType h1 = 0;
+			io.readline(h1, "Hamiltonianh1=");
+			PauliSumType pauliX = HamiltonianFromExpressionType(strX, bits_, false).getPauliSum();
+			pauliX *= h1;
+			pauliSum_ += pauliX;
+
+			RealType h2 = 0;
+			io.readline(h2, "Hamiltonianh2=");
+			PauliSumType pauliXx = HamiltonianFromExpressionType(strXx, bits_, false).getPauliSum();
+			pauliXx *= h2;
+			pauliSum_ += pauliXx;
+			return;
+		}
+
+		std::cerr<<"Asumming Hamiltonian Expression\n";
+		pauliSum_ = HamiltonianFromExpressionType(ham, bits_, false).getPauliSum();
 	}
 
 	void fillFromFile(PsimagLite::String filename, typename InputNgType::Readable& io)
@@ -263,12 +491,59 @@ private:
 		try {
 			io.read(basis_, "Basis");
 			needsTransformAndTruncate_ = true;
-			transformAndTruncate(mat);
-			std::cerr<<"Has basis of size "<<basis_.size()<<"\n";
 		} catch (std::exception&) {
 			fullMatrixToCrsMatrix(matrix_, mat);
-			printGs(mat);
+			return;
 		}
+
+		if (sector_.isActive())
+			err("SymmetrySector and Basis cannot be used together\n");
+
+		int reduced = 0;
+		try {
+			io.readline(reduced, "HamiltonianReducedBasis=");
+		} catch (std::exception&) {}
+
+		transformAndTruncate(mat, reduced > 0);
+		std::cerr<<"Has basis of size "<<basis_.size()<<"\n";
+	}
+
+	// Uses the binary matrix in filename in place
+	void fillFromBinary(PsimagLite::String filename, typename InputNgType::Readable& io)
+	{
+		bool hasScaleOrBasis = false;
+		VectorType scale;
+		try {
+			io.read(scale, "ScaleHamiltonian");
+			hasScaleOrBasis = true;
+		} catch (std::exception&) {}
+
+		VectorSizeType basis;
+		try {
+			io.read(basis, "Basis");
+			hasScaleOrBasis = true;
+		} catch (std::exception&) {}
+
+		if (hasScaleOrBasis)
+			err("ScaleHamiltonian and Basis cannot be used with the binary matrix " +
+			    filename + "\n");
+
+		typedef typename CompactCrsType::MappedCrsPointerType MappedCrsPointerType;
+		compact_ = CompactCrsType(MappedCrsPointerType(new MappedCrs(filename)));
+
+		const SizeType hilbert = (1 << bits_);
+		if (compact_.rows() != hilbert)
+			err("Matrix rows = " + ttos(compact_.rows()) + " but " + ttos(hilbert) +
+			    " expected\n");
+
+		int hermitian = -1;
+		try {
+			io.readline(hermitian, "HamiltonianHermitian=");
+		} catch (std::exception&) {}
+
+		if (hermitian > 0 && !compact_.isUpper())
+			err("HamiltonianHermitian=1 but the binary matrix " + filename +
+			    " does not keep only the upper triangle\n");
 	}
 
 	static void scaleHamiltonian(PsimagLite::Matrix<ComplexType>& mat, const VectorType& scale, bool hasScale)
@@ -287,52 +562,179 @@ private:
 		}
 	}
 
-	static void printGs(PsimagLite::Matrix<ComplexType>& mat)
+	// Keeps only the rows and columns of matrix_ of the states of the sector
+	void restrictToSector()
 	{
-		assert(mat.rows() == mat.cols());
-		VectorRealType eigs(mat.rows());
-		diag(mat, eigs, 'V');
-		std::cout<<"Ground State Energy="<<eigs[0]<<"\n";
-		std::cout<<"Eigenvector------------\n";
-		ComplexType sum = 0;
-		for (SizeType i = 0; i < mat.rows(); ++i) {
-			ComplexType val = mat(i, 0);
-			sum += val*PsimagLite::conj(val);
-			if (std::norm(val) < 1e-8)
-				continue;
+		if (!sector_.isActive()) return;
 
-			std::cout<<i<<" "<<mat(i, 0)<<"\n";
+		const SizeType n = sector_.size();
+		SparseMatrixType matrix(n, n);
+		SizeType counter = 0;
+		for (SizeType i = 0; i < n; ++i) {
+			matrix.setRow(i, counter);
+			const SizeType row = sector_.state(i);
+			for (SizeType k = matrix_.getRowPtr(row); k < matrix_.getRowPtr(row + 1); ++k) {
+				const ComplexType value = matrix_.getValue(k);
+				if (std::norm(value) == 0) continue;
+
+				const SizeType j = sector_.index(matrix_.getCol(k));
+				if (j >= n)
+					err("The Hamiltonian does not conserve SymmetrySector: it connects states " +
+					    ttos(row) + " and " + ttos(matrix_.getCol(k)) + "\n");
+
+				matrix.pushCol(j);
+				matrix.pushValue(value);
+				++counter;
+			}
 		}
 
-		std::cout<<"-------- End eigenvector="<<sum<<"\n\n";
+		matrix.setRow(n, counter);
+		matrix.checkValidity();
+		matrix_ = matrix;
 	}
 
-	void allocateCacheVector(SizeType hilbertSpace)
+	/* The largest sum of the absolute values of a row of matrix_, which
+	   bounds the absolute value of its eigenvalues */
+	void findPenalty()
 	{
-		for (SizeType thread = 0; thread < cacheVector_.size(); ++thread)
-			cacheVector_[thread].resize(hilbertSpace);
+		penalty_ = 0;
+		for (SizeType i = 0; i < matrix_.rows(); ++i) {
+			RealType sum = 0;
+			for (SizeType k = matrix_.getRowPtr(i); k < matrix_.getRowPtr(i + 1); ++k)
+				sum += std::abs(matrix_.getValue(k));
+
+			penalty_ = std::max(penalty_, sum);
+		}
 	}
 
-	void transformAndTruncate(PsimagLite::Matrix<ComplexType>& mat)
+	// Keeps the diagonal of matrix_ in diagonal_ if matrix_ is diagonal, so
+	// that energy() and matrixVectorProduct() need not go through the CRS
+	void findDiagonal()
 	{
-		SizeType n = mat.rows();
-		assert(n == mat.cols());
-		SizeType hilbert = (1 << bits_);
-		PsimagLite::Matrix<ComplexType> dense(hilbert, hilbert);
-		assert(basis_.size() == n);
+		const SizeType rows = matrix_.rows();
+		VectorRealType diagonal(rows, 0);
+		for (SizeType i = 0; i < rows; ++i) {
+			for (SizeType k = matrix_.getRowPtr(i); k < matrix_.getRowPtr(i + 1); ++k) {
+				const ComplexType value = matrix_.getValue(k);
+				if (std::norm(value) == 0) continue;
+				if (matrix_.getCol(k) != i) return;
+				if (std::imag(value) != 0) return;
+				diagonal[i] += PsimagLite::real(value);
+			}
+		}
 
-		for (SizeType i = 0; i < n; ++i) {
-			SizeType ii = basis_[i];
-			for (SizeType j = 0; j < n; ++j) {
-				SizeType jj = basis_[j];
+		diagonal_.swap(diagonal);
+	}
 
-				dense(ii, jj) = mat(i, j);
+	RealType energyDiagonal(const VectorType& y) const
+	{
+		const SizeType n = y.size();
+		assert(n == diagonal_.size());
+		RealType e = 0;
+		// rounds as the product with the CRS matrix does
+		for (SizeType i = 0; i < n; ++i)
+			e += PsimagLite::real(PsimagLite::conj(y[i])*(diagonal_[i]*y[i]));
+
+		return e;
+	}
+
+	/* PSIDOC HamiltonianBasis
+	A Hamiltonian from a text file with $n$ rows can be given in a basis of $n$
+	of the $2^N$ states of $N$ bits, with Basis=[$b_0$, $b_1$, ...] in the input file,
+	so that its entry $(i, j)$ is the entry $(b_i, b_j)$ in the full space.
+	Only the nonzeros of the $n\times n$ matrix are stored, and no matrix of
+	$2^N\times 2^N$ is built, so that large $N$ can be used. The states of the basis
+	must be different and less than $2^N$. With HamiltonianReducedBasis=1, the
+	matrix is also kept with $n$ rows instead of $2^N$, and the energy gathers the
+	entries $b_i$ of the state vector first, so that its cost does not depend on $2^N$.
+	*/
+	void transformAndTruncate(const PsimagLite::Matrix<ComplexType>& mat, bool reduced)
+	{
+		const SizeType n = mat.rows();
+		assert(n == mat.cols());
+		const SizeType hilbert = (1 << bits_);
+		if (basis_.size() != n)
+			err("Basis has " + ttos(basis_.size()) + " states but the matrix has " +
+			    ttos(n) + " rows\n");
+
+		// order[k] is the index in basis_ of its k-th smallest state
+		VectorSizeType order(n);
+		for (SizeType i = 0; i < n; ++i)
+			order[i] = i;
+
+		const VectorSizeType& basis = basis_;
+		std::sort(order.begin(),
+		          order.end(),
+		          [&basis](SizeType a, SizeType b) { return basis[a] < basis[b]; });
+
+		for (SizeType k = 0; k < n; ++k) {
+			const SizeType state = basis_[order[k]];
+			if (state >= hilbert)
+				err("Basis state " + ttos(state) + " is not less than " + ttos(hilbert) + "\n");
+			if (k > 0 && state == basis_[order[k - 1]])
+				err("Basis state " + ttos(state) + " is repeated\n");
+		}
+
+		const SizeType rows = (reduced) ? n : hilbert;
+		matrix_.resize(rows, rows);
+		SizeType counter = 0;
+		SizeType r = 0;
+		for (SizeType k = 0; k < n; ++k) {
+			const SizeType i = order[k];
+			const SizeType row = (reduced) ? k : basis_[i];
+			for (; r <= row; ++r)
+				matrix_.setRow(r, counter);
+
+			for (SizeType k2 = 0; k2 < n; ++k2) {
+				const SizeType j = order[k2];
+				if (mat(i, j) == static_cast<ComplexType>(0)) continue;
+				matrix_.pushCol((reduced) ? k2 : basis_[j]);
+				matrix_.pushValue(mat(i, j));
+				++counter;
 			}
 		}
-		// dense(8+4+2+1=15,) = mat(0, 0);
 
-		fullMatrixToCrsMatrix(matrix_, dense);
-		printGs(dense);
+		for (; r <= rows; ++r)
+			matrix_.setRow(r, counter);
+
+		matrix_.checkValidity();
+
+		if (!reduced) return;
+
+		reducedBasis_.resize(n);
+		for (SizeType k = 0; k < n; ++k)
+			reducedBasis_[k] = basis_[order[k]];
+	}
+
+	// The entries of y in the reduced basis
+	VectorType gather(const VectorType& y) const
+	{
+		const SizeType n = reducedBasis_.size();
+		VectorType yReduced(n);
+		for (SizeType i = 0; i < n; ++i)
+			yReduced[i] = y[reducedBasis_[i]];
+
+		return yReduced;
+	}
+
+	RealType energyMatrix(const VectorType& y) const
+	{
+		if (diagonal_.size() > 0) return energyDiagonal(y);
+
+		return expectation_(compact_, y);
+	}
+
+	// x = H*y, for x all zeros, with the matrix or its diagonal
+	void matrixVectorProductMatrix(VectorType& x, const VectorType& y) const
+	{
+		if (diagonal_.size() == 0) {
+			compact_.matrixVectorProduct(x, y);
+			return;
+		}
+
+		assert(y.size() == diagonal_.size());
+		for (SizeType i = 0; i < y.size(); ++i)
+			x[i] = diagonal_[i]*y[i];
 	}
 
 	static PsimagLite::String createNnn(const PsimagLite::String& A,
@@ -384,19 +786,23 @@ private:
 		return buffer;
 	}
 
-	static void addMatrixWithWeight(SparseMatrixType& m, RealType weight, const SparseMatrixType& a)
-	{
-		m += weight*a;
-	}
-
 	TypeEnum hamTipo;
 	SizeType bits_;
 	bool periodic_;
 	IsingGraphType* isingGraph_;
+	PauliSumType pauliSum_;
 	SparseMatrixType matrix_;
+	VectorRealType diagonal_;
 	VectorSizeType basis_;
+	VectorSizeType reducedBasis_;
 	bool needsTransformAndTruncate_;
-	mutable VectorVectorType cacheVector_;
+	int printGroundState_;
+	RealType groundStateEnergy_;
+	VectorType groundState_;
+	SymmetrySector sector_;
+	RealType penalty_;
+	CompactCrsType compact_;
+	CrsExpectationType expectation_;
 };
 }
 #endif // EVENDIM_HAMILTONIAN_H
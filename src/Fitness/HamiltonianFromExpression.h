@@ -2,9 +2,9 @@
 #define HAMILTONIANFROMEXPRESSION_H
 #include "Vector.h"
 #include "CanonicalExpression.h"
-#include "HamiltonianSpec.h"
 #include "CrsMatrix.h"
 #include "AuxForHamSpec.h"
+#include "PauliSumSpec.h"
 
 namespace Gep {
 
@@ -14,20 +14,32 @@ class HamiltonianFromExpression {
 public:
 
 	typedef PsimagLite::CrsMatrix<ComplexType> SparseMatrixType;
-	typedef HamiltonianSpec<SparseMatrixType> HamiltonianSpecType;
-	typedef PsimagLite::CanonicalExpression<HamiltonianSpecType> CanonicalExpressionType;
 	typedef AuxForHamSpec AuxForHamSpecType;
+	typedef PauliSumSpec<ComplexType> PauliSumSpecType;
+	typedef typename PauliSumSpecType::ResultType PauliSumType;
+	typedef PsimagLite::CanonicalExpression<PauliSumSpecType> CanonicalExpressionType;
 
-	// 0.42*P3;H2+-4.2*Rx0:1.57*Sy1
+	/* 0.42*P3;H2+-4.2*Rx0:1.57*Sy1
+	   The expression is first simplified to a sum of Pauli strings, and then,
+	   unless buildMatrix is false, the matrix is filled from that sum in one
+	   pass over its rows, split among threads; no matrices are multiplied */
 	HamiltonianFromExpression(PsimagLite::String expression,
-	                          SizeType numberOfBits)
-	    : hamString_(expression), bits_(numberOfBits)
+	                          SizeType numberOfBits,
+	                          bool buildMatrix = true,
+	                          SizeType threads = 1)
+	    : hamString_(expression), bits_(numberOfBits), pauliSum_(numberOfBits)
 	{
-		fillMatrix();
+		fillPauliSum();
+		if (!buildMatrix) return;
+
+		pauliSum_.groupTerms();
+		pauliSum_.fillCrs(matrix_, threads);
 	}
 
 	const SparseMatrixType& getMatrix() const { return matrix_; }
 
+	const PauliSumType& getPauliSum() const { return pauliSum_; }
+
 	// just for checking
 	static void solveIt(const SparseMatrixType& matrix)
 	{
@@ -41,16 +53,14 @@ public:
 
 private:
 
-	void fillMatrix()
+	void fillPauliSum()
 	{
-		HamiltonianSpecType hamSpec(bits_);
-		CanonicalExpressionType canonicalExpression(hamSpec);
+		PauliSumSpecType pauliSumSpec;
+		CanonicalExpressionType canonicalExpression(pauliSumSpec);
 		hamString_ = killSpaces(hamString_);
 		AuxForHamSpecType aux(bits_);
-		typename HamiltonianSpecType::ResultType quasiMatrix(bits_);
-		typename HamiltonianSpecType::ResultType emptyMatrix(bits_);
-		canonicalExpression(quasiMatrix, hamString_, emptyMatrix, aux);
-		matrix_ = quasiMatrix.getCRS();
+		PauliSumType emptyPauliSum(bits_);
+		canonicalExpression(pauliSum_, hamString_, emptyPauliSum, aux);
 	}
 
 	static PsimagLite::String killSpaces(PsimagLite::String str)
@@ -65,6 +75,7 @@ private:
 	PsimagLite::String hamString_;
 	SizeType bits_;
 	SparseMatrixType matrix_;
+	PauliSumType pauliSum_;
 };
 }
 #endif // HAMILTONIANFROMEXPRESSION_H
@@ -59,32 +59,6 @@ public:
 
 		const SparseMatrixType& getCRS() const { return data_; }
 
-	private:
-
-		void blowUp(const MatrixType& gateMatrix, SizeType bit)
-		{
-			const SizeType smallCols = gateMatrix.cols();
-			assert(smallCols == gateMatrix.rows());
-			const SizeType rows = data_.rows();
-			assert(rows == data_.cols());
-
-			SizeType counter = 0;
-			for (SizeType i = 0; i < rows; ++i) {
-				data_.setRow(i, counter);
-				const SizeType ip = extractIndexAtBit(i, bit);
-				for (SizeType jp = 0; jp < smallCols; ++jp) {
-					const ComplexOrRealType val = gateMatrix(ip, jp);
-					if (std::norm(val) == 0) continue;
-					SizeType j = replaceIndexAtBit(i, bit, jp);
-					data_.pushValue(val);
-					data_.pushCol(j);
-					++counter;
-				}
-			}
-
-			data_.setRow(rows, counter);
-		}
-
 		//Ry0:1.57
 		static std::pair<PsimagLite::String, SizeType>  extractNameAndBit(PsimagLite::String str)
 		{
@@ -128,6 +102,32 @@ public:
 			return (c >= 48 && c <= 57);
 		}
 
+	private:
+
+		void blowUp(const MatrixType& gateMatrix, SizeType bit)
+		{
+			const SizeType smallCols = gateMatrix.cols();
+			assert(smallCols == gateMatrix.rows());
+			const SizeType rows = data_.rows();
+			assert(rows == data_.cols());
+
+			SizeType counter = 0;
+			for (SizeType i = 0; i < rows; ++i) {
+				data_.setRow(i, counter);
+				const SizeType ip = extractIndexAtBit(i, bit);
+				for (SizeType jp = 0; jp < smallCols; ++jp) {
+					const ComplexOrRealType val = gateMatrix(ip, jp);
+					if (std::norm(val) == 0) continue;
+					SizeType j = replaceIndexAtBit(i, bit, jp);
+					data_.pushValue(val);
+					data_.pushCol(j);
+					++counter;
+				}
+			}
+
+			data_.setRow(rows, counter);
+		}
+
 		SizeType extractIndexAtBit(SizeType ind, SizeType bit) const
 		{
 			checkBits(ind, bit);
@@ -16,6 +16,8 @@ public:
 	typedef Graph GraphType;
 	typedef PsimagLite::CrsMatrix<ComplexType> SparseMatrixType;
 	typedef typename PsimagLite::Vector<ComplexType>::Type VectorType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
 
 	IsingGraph(SizeType bits, RealType coupling, bool periodic, PsimagLite::String graphFile)
 	    : bits_(bits),
@@ -24,38 +26,64 @@ public:
 	{
 		if (graph_.vertices() != bits)
 			err("Graph vertices != bits\n");
+
+		fillDiagonal();
 	}
 
+	// One pass over the states, with the diagonal computed once
 	RealType energyZZ(const VectorType& v) const
 	{
 		const SizeType hilbertSpace = v.size();
+		assert(hilbertSpace == diagonal_.size());
 		RealType e = 0;
-		assert(bits_ > 1);
-		for (SizeType i = 0; i < hilbertSpace; ++i) {
-			for (SizeType site = 0; site < bits_ - 1; ++site) {
-				SizeType maskSite = (1 << site);
-				SizeType j = i & maskSite;
-				for (SizeType site2 = site + 1; site2 < bits_; ++site2) {
-					if (!graph_.connected(site, site2)) continue;
-					SizeType maskSite2 = (1 << site2);
-					SizeType k = i & maskSite2;
-					SizeType jj = (j > 0);
-					SizeType kk = (k > 0);
-					RealType tmp = PsimagLite::real(PsimagLite::conj(v[i])*v[i]);
-					RealType value = (jj == kk) ? tmp : -tmp;
-					e += value;
-				}
-			}
-		}
+		for (SizeType i = 0; i < hilbertSpace; ++i)
+			e += PsimagLite::real(PsimagLite::conj(v[i])*v[i])*diagonal_[i];
 
 		return e*coupling_;
 	}
 
+	// x += H*y
+	void matrixVectorProduct(VectorType& x, const VectorType& y) const
+	{
+		const SizeType hilbertSpace = y.size();
+		assert(x.size() == hilbertSpace);
+		assert(hilbertSpace == diagonal_.size());
+		for (SizeType i = 0; i < hilbertSpace; ++i)
+			x[i] += diagonal_[i]*coupling_*y[i];
+	}
+
 private:
 
+	/* The diagonal of H/coupling, computed once: each edge (site, site2) has the
+	   mask with the bits of both sites set, and adds +1 to state i if i has an
+	   even number of those bits set, and -1 otherwise */
+	void fillDiagonal()
+	{
+		assert(bits_ > 1);
+		VectorSizeType masks;
+		for (SizeType site = 0; site < bits_ - 1; ++site) {
+			for (SizeType site2 = site + 1; site2 < bits_; ++site2) {
+				if (!graph_.connected(site, site2)) continue;
+				masks.push_back((1 << site) | (1 << site2));
+			}
+		}
+
+		const SizeType hilbertSpace = (1 << bits_);
+		const int edges = masks.size();
+		diagonal_.resize(hilbertSpace);
+		for (SizeType i = 0; i < hilbertSpace; ++i) {
+			int odd = 0;
+			for (SizeType j = 0; j < masks.size(); ++j)
+				odd += (__builtin_popcountl(i & masks[j]) & 1);
+
+			diagonal_[i] = edges - 2*odd;
+		}
+	}
+
 	SizeType bits_;
 	RealType coupling_;
 	GraphType graph_;
+	VectorRealType diagonal_;
 };
 }
 #endif // ISINGGRAPH_HH
@@ -0,0 +1,165 @@
+#ifndef LANCZOSGROUNDSTATE_H
+#define LANCZOSGROUNDSTATE_H
+#include "Vector.h"
+#include "PsimagLite.h"
+#include "Matrix.h"
+#include "MersenneTwister.h"
+
+namespace Gep {
+
+/* PSIDOC LanczosGroundState
+The exact ground state of the Hamiltonian is printed at startup, except for
+Ising Hamiltonians, unless HamiltonianPrintGroundState=0 in the input file.
+With HamiltonianPrintGroundState=2 it is also found for Ising Hamiltonians,
+and each individual printed is followed by the ratio of its energy to the
+ground state energy, and by the overlap $|\langle\psi_0|\psi\rangle|^2$ of its state
+with the ground state. With HamiltonianGroundStateFile=name the ground state is read
+from that file if it exists, and written to it otherwise.
+The ground state is found by dense diagonalization
+only if the Hilbert space has at most 1024 states. For larger spaces, and always
+for Hamiltonians that are not kept as a matrix, it is found by the Lanczos
+method, which needs only products of the Hamiltonian with vectors, and memory for a few
+vectors. The Lanczos vectors are not stored: a first pass builds the
+tridiagonal matrix until its lowest eigenvalue changes by less than $10^{-12}$,
+relative, or for 500 steps, and a second pass repeats the recursion from the
+same starting vector to add up the ground state vector.
+*/
+template<typename ComplexType>
+class LanczosGroundState {
+
+public:
+
+	typedef typename PsimagLite::Real<ComplexType>::Type RealType;
+	typedef typename PsimagLite::Vector<ComplexType>::Type VectorType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Matrix<RealType> MatrixRealType;
+
+	LanczosGroundState(SizeType maxSteps, RealType tol)
+	    : maxSteps_(std::max(maxSteps, static_cast<SizeType>(2))), tol_(tol)
+	{}
+
+	/* Returns the lowest eigenvalue of op, of dimension rows, and its
+	   eigenvector in psi, where op.matrixVectorProduct(x, y) sets x = op*y */
+	template<typename OperatorType>
+	RealType operator()(VectorType& psi, const OperatorType& op, SizeType rows) const
+	{
+		VectorRealType alpha;
+		VectorRealType beta;
+		VectorType v;
+		VectorType vPrev;
+		VectorType w;
+
+		// first pass: the tridiagonal matrix
+		start(v, vPrev, rows);
+		RealType e = 0;
+		for (SizeType j = 0; j < maxSteps_; ++j) {
+			const RealType b = step(alpha, beta, v, vPrev, w, op);
+			const bool done = (b < 1e-12 || j + 1 == maxSteps_);
+			if (!done && (j + 1) % checkEvery_ != 0) continue;
+
+			const RealType eNew = lowest(alpha, beta, 0);
+			const bool converged = (j > 0 && fabs(eNew - e) <
+			                        tol_*std::max(fabs(eNew), static_cast<RealType>(1)));
+			e = eNew;
+			if (done || converged) break;
+		}
+
+		// second pass: the eigenvector
+		VectorRealType c;
+		e = lowest(alpha, beta, &c);
+		const SizeType steps = alpha.size();
+		VectorRealType alpha2;
+		VectorRealType beta2;
+		start(v, vPrev, rows);
+		psi.resize(rows);
+		std::fill(psi.begin(), psi.end(), 0);
+		for (SizeType j = 0; j < steps; ++j) {
+			for (SizeType i = 0; i < rows; ++i)
+				psi[i] += c[j]*v[i];
+			if (j + 1 < steps) step(alpha2, beta2, v, vPrev, w, op);
+		}
+
+		const RealType norm = sqrt(PsimagLite::real(psi*psi));
+		for (SizeType i = 0; i < rows; ++i)
+			psi[i] /= norm;
+
+		return e;
+	}
+
+private:
+
+	// a normalized random vector, from the same seed every time
+	static void start(VectorType& v, VectorType& vPrev, SizeType rows)
+	{
+		PsimagLite::MersenneTwister rng(1234);
+		v.resize(rows);
+		for (SizeType i = 0; i < rows; ++i)
+			v[i] = rng() - 0.5;
+
+		const RealType norm = sqrt(PsimagLite::real(v*v));
+		for (SizeType i = 0; i < rows; ++i)
+			v[i] /= norm;
+
+		vPrev.resize(rows);
+		std::fill(vPrev.begin(), vPrev.end(), 0);
+	}
+
+	/* One Lanczos step: appends alpha_j and beta_{j+1}, moves v to vPrev and
+	   the next vector to v, and returns beta_{j+1} */
+	template<typename OperatorType>
+	static RealType step(VectorRealType& alpha,
+	                     VectorRealType& beta,
+	                     VectorType& v,
+	                     VectorType& vPrev,
+	                     VectorType& w,
+	                     const OperatorType& op)
+	{
+		const SizeType rows = v.size();
+		const RealType betaPrev = (beta.size() > 0) ? beta.back() : 0;
+		op.matrixVectorProduct(w, v);
+		const RealType a = PsimagLite::real(v*w);
+		for (SizeType i = 0; i < rows; ++i)
+			w[i] -= a*v[i] + betaPrev*vPrev[i];
+
+		const RealType b = sqrt(PsimagLite::real(w*w));
+		alpha.push_back(a);
+		beta.push_back(b);
+		if (b < 1e-12) return b;
+
+		for (SizeType i = 0; i < rows; ++i) {
+			vPrev[i] = v[i];
+			v[i] = w[i]/b;
+		}
+
+		return b;
+	}
+
+	// The lowest eigenvalue of the tridiagonal matrix, and its eigenvector in c if not null
+	static RealType lowest(const VectorRealType& alpha, const VectorRealType& beta, VectorRealType* c)
+	{
+		const SizeType n = alpha.size();
+		MatrixRealType t(n, n);
+		for (SizeType i = 0; i < n; ++i) {
+			t(i, i) = alpha[i];
+			if (i + 1 == n) break;
+			t(i, i + 1) = t(i + 1, i) = beta[i];
+		}
+
+		VectorRealType eigs(n);
+		diag(t, eigs, (c) ? 'V' : 'N');
+		if (c) {
+			c->resize(n);
+			for (SizeType i = 0; i < n; ++i)
+				(*c)[i] = t(i, 0);
+		}
+
+		return eigs[0];
+	}
+
+	static const SizeType checkEvery_ = 10;
+	SizeType maxSteps_;
+	RealType tol_;
+}; // class LanczosGroundState
+
+} // namespace Gep
+#endif // LANCZOSGROUNDSTATE_H
@@ -0,0 +1,322 @@
+#ifndef LBFGS_H
+#define LBFGS_H
+#include "Vector.h"
+#include "PsimagLite.h"
+#include "Concurrency.h"
+#include <map>
+
+namespace Gep {
+
+/* PSIDOC Lbfgs
+When MinimizerAlgorithm=``LBFGS'' in the input file, the angles of each circuit are
+minimized with the limited-memory BFGS method, using the analytic gradients
+of the fitness class. The inverse Hessian is approximated by the last
+MinimizerMemory pairs of steps and gradient changes, and the first step, without any pair,
+moves the largest angle by MinimizerDelta. The landscapes are periodic in the
+angles, so that a quadratic model cannot be trusted beyond a fraction of a period;
+each step is therefore first shortened so that no angle moves by more than $\pi/2$, and then
+backtracked by safeguarded quadratic interpolation until the energy
+decreases enough (Armijo condition). The minimization converges when no component of
+the gradient exceeds MinimizerTolerance, or when not even the steepest descent
+direction can lower the energy.
+
+With MinimizerWarmStart=1, the curvature pairs of each minimization are kept until
+the end of the next generation, indexed by the sequence of gates with angles of the circuit,
+and a circuit with the same such sequence, as is the case for a child that differs from its
+parent in a gate without angle, starts with them instead of with an empty memory.
+*/
+template<typename FunctionType>
+class Lbfgs {
+
+public:
+
+	typedef typename FunctionType::FieldType RealType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef typename PsimagLite::Vector<VectorRealType>::Type VectorVectorRealType;
+
+	// The curvature pairs, oldest first
+	struct PairsType {
+		VectorVectorRealType s;
+		VectorVectorRealType y;
+	};
+
+	Lbfgs(FunctionType& function, SizeType maxIter, SizeType memory, bool verbose)
+	    : function_(function),
+	      maxIter_(maxIter),
+	      memory_(std::max(memory, static_cast<SizeType>(1))),
+	      verbose_(verbose),
+	      converged_(false)
+	{}
+
+	// Starts from the pairs of an earlier minimization, if any
+	void setPairs(const PairsType* pairs)
+	{
+		if (!pairs || pairs->s.size() == 0) return;
+		if (pairs->s[0].size() != function_.size()) return;
+		pairs_ = *pairs;
+	}
+
+	const PairsType& pairs() const { return pairs_; }
+
+	bool converged() const { return converged_; }
+
+	/* Minimizes x for function with the memory, delta and verbosity of minParams,
+	   and with MinimizerWarmStart=1 starts from, and then keeps, the pairs in warmStart
+	   of the sequence of gates with angles of function. Returns the number of iterations */
+	template<typename MinimizerParamsType, typename WarmStartType>
+	static int minimize(bool& converged,
+	                    VectorRealType& x,
+	                    FunctionType& function,
+	                    SizeType maxIter,
+	                    RealType tol,
+	                    const MinimizerParamsType& minParams,
+	                    WarmStartType& warmStart,
+	                    SizeType threadNum)
+	{
+		Lbfgs lbfgs(function, maxIter, minParams.memory, minParams.verbose);
+		PsimagLite::String key;
+		if (minParams.warmStart) {
+			key = function.signature();
+			lbfgs.setPairs(warmStart.find(key));
+		}
+
+		const int used = lbfgs.minimize(x, minParams.delta, tol);
+		converged = lbfgs.converged();
+		if (minParams.warmStart) warmStart.store(key, lbfgs.pairs(), threadNum);
+		return used;
+	}
+
+	// Minimizes starting at x, and returns the number of iterations
+	int minimize(VectorRealType& x, RealType delta, RealType tol)
+	{
+		const SizeType n = x.size();
+		RealType fx = function_(x);
+		VectorRealType g(n);
+		function_.df(g, x);
+
+		converged_ = false;
+		VectorRealType d(n);
+		VectorRealType xNew(n);
+		VectorRealType gNew(n);
+		SizeType iter = 0;
+		for (; iter < maxIter_; ++iter) {
+			if (maxAbs(g) < tol) {
+				converged_ = true;
+				break;
+			}
+
+			direction(d, g, delta);
+			RealType slope = dot(g, d);
+			if (slope >= 0) {
+				// not a descent direction; forget the curvature
+				clearPairs();
+				direction(d, g, delta);
+				slope = dot(g, d);
+			}
+
+			RealType fNew = 0;
+			if (!lineSearch(xNew, fNew, x, fx, d, slope)) {
+				if (pairs_.s.size() == 0) {
+					// not even steepest descent lowers the energy
+					converged_ = true;
+					break;
+				}
+
+				clearPairs();
+				continue;
+			}
+
+			function_.df(gNew, xNew);
+			pushPair(x, xNew, g, gNew);
+			x.swap(xNew);
+			g.swap(gNew);
+			fx = fNew;
+
+			if (verbose_)
+				std::cerr<<"Lbfgs: iter= "<<iter<<" f= "<<fx<<" |g|= "<<maxAbs(g)<<"\n";
+		}
+
+		return iter;
+	}
+
+private:
+
+	// d = -H g with the two-loop recursion
+	void direction(VectorRealType& d, const VectorRealType& g, RealType delta) const
+	{
+		const SizeType n = g.size();
+		const SizeType m = pairs_.s.size();
+		for (SizeType i = 0; i < n; ++i)
+			d[i] = -g[i];
+
+		if (m == 0) {
+			const RealType gmax = maxAbs(g);
+			if (gmax == 0) return;
+			const RealType scale = delta/gmax;
+			for (SizeType i = 0; i < n; ++i)
+				d[i] *= scale;
+			return;
+		}
+
+		VectorRealType alpha(m);
+		for (SizeType k = m; k > 0; --k) {
+			const VectorRealType& s = pairs_.s[k - 1];
+			const VectorRealType& y = pairs_.y[k - 1];
+			alpha[k - 1] = dot(s, d)/dot(s, y);
+			for (SizeType i = 0; i < n; ++i)
+				d[i] -= alpha[k - 1]*y[i];
+		}
+
+		const VectorRealType& sLast = pairs_.s[m - 1];
+		const VectorRealType& yLast = pairs_.y[m - 1];
+		const RealType gamma = dot(sLast, yLast)/dot(yLast, yLast);
+		for (SizeType i = 0; i < n; ++i)
+			d[i] *= gamma;
+
+		for (SizeType k = 0; k < m; ++k) {
+			const VectorRealType& s = pairs_.s[k];
+			const VectorRealType& y = pairs_.y[k];
+			const RealType beta = dot(y, d)/dot(s, y);
+			for (SizeType i = 0; i < n; ++i)
+				d[i] += (alpha[k] - beta)*s[i];
+		}
+	}
+
+	// Returns true if a point xNew with energy fNew < fx was found along d
+	bool lineSearch(VectorRealType& xNew,
+	                RealType& fNew,
+	                const VectorRealType& x,
+	                RealType fx,
+	                const VectorRealType& d,
+	                RealType slope)
+	{
+		// a quarter of the period of the rotations, and the sufficient decrease
+		const RealType maxStep = 0.5*M_PI;
+		const RealType armijo = 1e-4;
+
+		const SizeType n = x.size();
+		const RealType dmax = maxAbs(d);
+		if (dmax == 0 || slope >= 0) return false;
+
+		RealType t = (dmax > maxStep) ? maxStep/dmax : 1;
+		for (SizeType j = 0; j < maxBacktracks_; ++j) {
+			for (SizeType i = 0; i < n; ++i)
+				xNew[i] = x[i] + t*d[i];
+
+			fNew = function_(xNew);
+			if (fNew <= fx + armijo*t*slope) return true;
+
+			// minimum of the quadratic through fx, slope and fNew
+			RealType tNew = -0.5*slope*t*t/(fNew - fx - slope*t);
+			if (tNew != tNew) tNew = 0.5*t;
+			t = std::min(std::max(tNew, 0.1*t), 0.5*t);
+		}
+
+		return false;
+	}
+
+	void pushPair(const VectorRealType& x,
+	              const VectorRealType& xNew,
+	              const VectorRealType& g,
+	              const VectorRealType& gNew)
+	{
+		const SizeType n = x.size();
+		VectorRealType s(n);
+		VectorRealType y(n);
+		for (SizeType i = 0; i < n; ++i) {
+			s[i] = xNew[i] - x[i];
+			y[i] = gNew[i] - g[i];
+		}
+
+		// keeps the approximation positive definite
+		if (dot(s, y) <= 1e-12*sqrt(dot(s, s)*dot(y, y))) return;
+
+		if (pairs_.s.size() == memory_) {
+			pairs_.s.erase(pairs_.s.begin());
+			pairs_.y.erase(pairs_.y.begin());
+		}
+
+		pairs_.s.push_back(s);
+		pairs_.y.push_back(y);
+	}
+
+	void clearPairs()
+	{
+		pairs_.s.clear();
+		pairs_.y.clear();
+	}
+
+	static RealType dot(const VectorRealType& a, const VectorRealType& b)
+	{
+		const SizeType n = a.size();
+		assert(n == b.size());
+		RealType sum = 0;
+		for (SizeType i = 0; i < n; ++i)
+			sum += a[i]*b[i];
+		return sum;
+	}
+
+	static RealType maxAbs(const VectorRealType& v)
+	{
+		RealType max = 0;
+		for (SizeType i = 0; i < v.size(); ++i)
+			max = std::max(max, static_cast<RealType>(fabs(v[i])));
+		return max;
+	}
+
+	static const SizeType maxBacktracks_ = 20;
+
+	FunctionType& function_;
+	SizeType maxIter_;
+	SizeType memory_;
+	bool verbose_;
+	bool converged_;
+	PairsType pairs_;
+}; // class Lbfgs
+
+template<typename FunctionType>
+const SizeType Lbfgs<FunctionType>::maxBacktracks_;
+
+/* Keeps the curvature pairs of the minimizations of one generation for the
+   next one. Threads store into their own maps, and all read the merged map
+   of the previous generation */
+template<typename PairsType>
+class LbfgsWarmStart {
+
+	typedef std::map<PsimagLite::String, PairsType> MapType;
+
+public:
+
+	LbfgsWarmStart()
+	    : current_(PsimagLite::Concurrency::codeSectionParams.npthreads)
+	{}
+
+	const PairsType* find(const PsimagLite::String& key) const
+	{
+		typename MapType::const_iterator it = previous_.find(key);
+		return (it == previous_.end()) ? nullptr : &it->second;
+	}
+
+	void store(const PsimagLite::String& key, const PairsType& pairs, SizeType threadNum)
+	{
+		assert(threadNum < current_.size());
+		current_[threadNum][key] = pairs;
+	}
+
+	void startGeneration()
+	{
+		previous_.clear();
+		for (SizeType i = 0; i < current_.size(); ++i) {
+			previous_.insert(current_[i].begin(), current_[i].end());
+			current_[i].clear();
+		}
+	}
+
+private:
+
+	MapType previous_;
+	typename PsimagLite::Vector<MapType>::Type current_;
+}; // class LbfgsWarmStart
+
+} // namespace Gep
+#endif // LBFGS_H
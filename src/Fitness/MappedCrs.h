@@ -0,0 +1,263 @@
+#ifndef MAPPEDCRS_H
+#define MAPPEDCRS_H
+#include "PsimagLite.h"
+#include <fstream>
+#include <complex>
+#include <cstring>
+#include <cstdint>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace Gep {
+
+/* PSIDOC MappedCrs
+Hamiltonian="file:name" reads either a text matrix or a binary sparse matrix,
+told apart by the first bytes of the file. A binary matrix is memory-mapped,
+and its arrays are used in place, without parsing or copying. The file starts
+with the 8 bytes \verb!EVDCRS__!, followed by five 64-bit unsigned integers: the
+version of the format, now 1, the flags, 1 if the values are real, plus 2 if
+only the upper triangle of a Hermitian matrix is kept, the number of rows, the
+number of nonzeros, and a checksum. Then come the rows+1 row pointers and the
+column of each nonzero, as 64-bit unsigned integers, and the values, as doubles,
+or as pairs of doubles if complex, all in native byte order. The checksum is a
+64-bit FNV-1a hash of the 8-byte words after the header, and is verified when the
+file is opened. Use the program hamiltonianFromText, or CompactCrs::fromText(),
+to convert a text matrix once; it keeps real values and the upper triangle when
+it can, as described above. ScaleHamiltonian and Basis cannot be used with binary
+matrices.
+*/
+class MappedCrs {
+
+public:
+
+	typedef double RealType;
+	typedef std::complex<RealType> ComplexType;
+	typedef std::uint64_t HeaderIntType;
+
+	enum {FLAG_REAL = 1, FLAG_UPPER = 2};
+
+	MappedCrs(PsimagLite::String filename)
+	    : filename_(filename),
+	      fd_(-1),
+	      data_(nullptr),
+	      bytes_(0),
+	      flags_(0),
+	      rows_(0),
+	      nonZeros_(0)
+	{
+		if (sizeof(SizeType) != sizeof(HeaderIntType))
+			err("MappedCrs: needs 64-bit SizeType\n");
+
+		fd_ = open(filename_.c_str(), O_RDONLY);
+		if (fd_ < 0)
+			err("MappedCrs: Could not open file " + filename_ + "\n");
+
+		struct stat st;
+		if (fstat(fd_, &st) != 0 || static_cast<SizeType>(st.st_size) < headerSize()) {
+			close(fd_);
+			err("MappedCrs: File " + filename_ + " is too short\n");
+		}
+
+		bytes_ = st.st_size;
+		void* ptr = mmap(nullptr, bytes_, PROT_READ, MAP_PRIVATE, fd_, 0);
+		if (ptr == MAP_FAILED) {
+			close(fd_);
+			err("MappedCrs: Could not map file " + filename_ + "\n");
+		}
+
+		data_ = static_cast<const char*>(ptr);
+
+		// the destructor does not run if the constructor throws
+		try {
+			readHeader();
+			checkRows();
+		} catch (...) {
+			release();
+			throw;
+		}
+	}
+
+	~MappedCrs() { release(); }
+
+	// True if filename starts as a binary matrix
+	static bool isBinary(PsimagLite::String filename)
+	{
+		std::ifstream fin(filename, std::ios::binary);
+		char buffer[8];
+		if (!fin.read(buffer, 8)) return false;
+		return (std::memcmp(buffer, magic(), 8) == 0);
+	}
+
+	SizeType rows() const { return rows_; }
+
+	SizeType nonZeros() const { return nonZeros_; }
+
+	bool isReal() const { return (flags_ & FLAG_REAL); }
+
+	bool isUpper() const { return (flags_ & FLAG_UPPER); }
+
+	// The arrays, in place in the mapped file
+	const SizeType* rowPtr() const
+	{
+		return reinterpret_cast<const SizeType*>(data_ + headerSize());
+	}
+
+	const SizeType* col() const { return rowPtr() + rows_ + 1; }
+
+	const RealType* valuesReal() const
+	{
+		assert(isReal());
+		return reinterpret_cast<const RealType*>(col() + nonZeros_);
+	}
+
+	const ComplexType* values() const
+	{
+		assert(!isReal());
+		return reinterpret_cast<const ComplexType*>(col() + nonZeros_);
+	}
+
+	/* Writes matrix, which has rows(), isReal(), isUpper() and the arrays
+	   rowPtr(), col(), and valuesReal() or values() */
+	template<typename SomeCrsType>
+	static void write(PsimagLite::String filename, const SomeCrsType& matrix)
+	{
+		const HeaderIntType rows = matrix.rows();
+		const HeaderIntType nonZeros = matrix.rowPtr()[rows];
+		const HeaderIntType flags = ((matrix.isReal()) ? FLAG_REAL : 0) |
+		                            ((matrix.isUpper()) ? FLAG_UPPER : 0);
+		const SizeType valueBytes = (matrix.isReal()) ? sizeof(RealType) : sizeof(ComplexType);
+		const char* values = (matrix.isReal())
+		        ? reinterpret_cast<const char*>(matrix.valuesReal())
+		        : reinterpret_cast<const char*>(matrix.values());
+		const HeaderIntType version = 1;
+
+		HeaderIntType checksum = checksumStart();
+		checksum = hash(checksum, reinterpret_cast<const char*>(matrix.rowPtr()),
+		                (rows + 1)*sizeof(HeaderIntType));
+		checksum = hash(checksum, reinterpret_cast<const char*>(matrix.col()),
+		                nonZeros*sizeof(HeaderIntType));
+		checksum = hash(checksum, values, nonZeros*valueBytes);
+
+		std::ofstream fout(filename, std::ios::binary);
+		if (!fout || !fout.good())
+			err("MappedCrs::write(): Could not open file " + filename + "\n");
+
+		fout.write(magic(), 8);
+		fout.write(reinterpret_cast<const char*>(&version), sizeof(HeaderIntType));
+		fout.write(reinterpret_cast<const char*>(&flags), sizeof(HeaderIntType));
+		fout.write(reinterpret_cast<const char*>(&rows), sizeof(HeaderIntType));
+		fout.write(reinterpret_cast<const char*>(&nonZeros), sizeof(HeaderIntType));
+		fout.write(reinterpret_cast<const char*>(&checksum), sizeof(HeaderIntType));
+		fout.write(reinterpret_cast<const char*>(matrix.rowPtr()),
+		           (rows + 1)*sizeof(HeaderIntType));
+		fout.write(reinterpret_cast<const char*>(matrix.col()), nonZeros*sizeof(HeaderIntType));
+		fout.write(values, nonZeros*valueBytes);
+
+		if (!fout.good())
+			err("MappedCrs::write(): Could not write file " + filename + "\n");
+	}
+
+private:
+
+	MappedCrs(const MappedCrs&) = delete;
+
+	MappedCrs& operator=(const MappedCrs&) = delete;
+
+	// Unmaps and closes the file
+	void release()
+	{
+		if (data_) munmap(const_cast<char*>(data_), bytes_);
+		if (fd_ >= 0) close(fd_);
+		data_ = nullptr;
+		fd_ = -1;
+	}
+
+	static const char* magic() { return "EVDCRS__"; }
+
+	static SizeType headerSize() { return 8 + 5*sizeof(HeaderIntType); }
+
+	static HeaderIntType checksumStart() { return 14695981039346656037ULL; }
+
+	// FNV-1a over the 8-byte words of data; bytes is a multiple of 8
+	static HeaderIntType hash(HeaderIntType h, const char* data, SizeType bytes)
+	{
+		assert(bytes % sizeof(HeaderIntType) == 0);
+		const HeaderIntType* words = reinterpret_cast<const HeaderIntType*>(data);
+		const SizeType n = bytes/sizeof(HeaderIntType);
+		for (SizeType i = 0; i < n; ++i)
+			h = (h ^ words[i])*1099511628211ULL;
+
+		return h;
+	}
+
+	HeaderIntType header(SizeType i) const
+	{
+		HeaderIntType value = 0;
+		std::memcpy(&value, data_ + 8 + i*sizeof(HeaderIntType), sizeof(HeaderIntType));
+		return value;
+	}
+
+	void readHeader()
+	{
+		if (std::memcmp(data_, magic(), 8) != 0)
+			err("MappedCrs: File " + filename_ + " is not a binary matrix\n");
+
+		const HeaderIntType version = header(0);
+		if (version != 1)
+			err("MappedCrs: File " + filename_ + " has version " + ttos(version) +
+			    ", but only version 1 can be read\n");
+
+		flags_ = header(1);
+		rows_ = header(2);
+		nonZeros_ = header(3);
+		if (flags_ > (FLAG_REAL | FLAG_UPPER))
+			err("MappedCrs: File " + filename_ + " has unknown flags\n");
+
+		const SizeType valueBytes = (isReal()) ? sizeof(RealType) : sizeof(ComplexType);
+		if (bytes_ != headerSize() + (rows_ + 1 + nonZeros_)*sizeof(HeaderIntType) +
+		        nonZeros_*valueBytes)
+			err("MappedCrs: File " + filename_ + " has the wrong size\n");
+
+		const HeaderIntType checksum = hash(checksumStart(),
+		                                    data_ + headerSize(),
+		                                    bytes_ - headerSize());
+		if (checksum != header(4))
+			err("MappedCrs: File " + filename_ + " is corrupted: wrong checksum\n");
+	}
+
+	/* The row pointers must not decrease, and the columns must be in range,
+	   and, if only the upper triangle is kept, not smaller than their row */
+	void checkRows() const
+	{
+		const SizeType* ptr = rowPtr();
+		if (ptr[0] != 0 || ptr[rows_] != nonZeros_)
+			err("MappedCrs: File " + filename_ + " has wrong row pointers\n");
+
+		for (SizeType r = 0; r < rows_; ++r)
+			if (ptr[r + 1] < ptr[r])
+				err("MappedCrs: File " + filename_ + " has wrong row pointers\n");
+
+		const SizeType* c = col();
+		for (SizeType r = 0; r < rows_; ++r) {
+			for (SizeType k = ptr[r]; k < ptr[r + 1]; ++k) {
+				if (c[k] >= rows_)
+					err("MappedCrs: File " + filename_ + " has a column out of range\n");
+				if (isUpper() && c[k] < r)
+					err("MappedCrs: File " + filename_ +
+					    " has a column below the diagonal, but keeps the upper triangle\n");
+			}
+		}
+	}
+
+	PsimagLite::String filename_;
+	int fd_;
+	const char* data_;
+	SizeType bytes_;
+	HeaderIntType flags_;
+	SizeType rows_;
+	SizeType nonZeros_;
+};
+}
+#endif // MAPPEDCRS_H
@@ -0,0 +1,108 @@
+#ifndef MULTISTART_H
+#define MULTISTART_H
+#include "Vector.h"
+#include "PsimagLite.h"
+#include "MersenneTwister.h"
+#include "Sort.h"
+
+namespace Gep {
+
+/* PSIDOC MultiStart
+With MinimizerStarts=$s$ larger than 1 in the input file, the angles of each circuit
+are minimized from $s$ starting points: the angles that the genome already has, and
+$s-1$ random ones. The starts race by successive halving in $r=\lceil\log_2 s\rceil+1$ rounds.
+In the first round every start gets $M/2^{r-1}$ iterations, where $M$ is MinimizerMaxIterations;
+after each round only the better half of the starts, by energy, resumes, and
+for as many iterations as it has had so far, so that only the best start
+reaches $M$ iterations. Hopeless starts are thus dropped early, and the
+$s$ starts together cost a few times one minimization instead of $s$ times.
+The starts of one circuit run in the thread of the circuit, one after the other.
+*/
+template<typename FunctionType>
+class MultiStart {
+
+public:
+
+	typedef typename FunctionType::FieldType RealType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef typename PsimagLite::Vector<VectorRealType>::Type VectorVectorRealType;
+	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
+
+	MultiStart(FunctionType& function, SizeType starts)
+	    : function_(function), starts_(std::max(starts, static_cast<SizeType>(1)))
+	{}
+
+	/* Minimizes starting at angles, and at random angles drawn with seed,
+	   where minimize(converged, x, maxIter) minimizes x in place with up to
+	   maxIter iterations and returns the iterations used. Returns the
+	   iterations used by all starts, and the best angles found in angles */
+	template<typename MinimizeType>
+	int operator()(bool& converged,
+	               VectorRealType& angles,
+	               SizeType maxIter,
+	               long unsigned int seed,
+	               const MinimizeType& minimize)
+	{
+		if (starts_ == 1) return minimize(converged, angles, maxIter);
+
+		PsimagLite::MersenneTwister rng(seed);
+		VectorVectorRealType x(starts_, angles);
+		for (SizeType i = 1; i < starts_; ++i)
+			for (SizeType j = 0; j < angles.size(); ++j)
+				x[i][j] = 2*M_PI*rng();
+
+		SizeType rounds = 1;
+		while ((static_cast<SizeType>(1) << (rounds - 1)) < starts_) ++rounds;
+
+		VectorRealType energies(starts_);
+		typename PsimagLite::Vector<bool>::Type done(starts_, false);
+		VectorSizeType alive(starts_);
+		for (SizeType i = 0; i < starts_; ++i)
+			alive[i] = i;
+
+		int used = 0;
+		SizeType spent = 0;
+		for (SizeType round = 0; round < rounds; ++round) {
+			const SizeType budget = maxIter >> (rounds - 1 - round);
+			const SizeType iterations = (budget > spent) ? budget - spent : 1;
+			for (SizeType k = 0; k < alive.size(); ++k) {
+				const SizeType i = alive[k];
+				bool convergedOne = false;
+				used += minimize(convergedOne, x[i], iterations);
+				done[i] = convergedOne;
+				energies[i] = function_(x[i]);
+			}
+
+			spent = budget;
+			if (round + 1 == rounds) break;
+
+			VectorRealType e(alive.size());
+			for (SizeType k = 0; k < alive.size(); ++k)
+				e[k] = energies[alive[k]];
+
+			VectorSizeType iperm(e.size());
+			PsimagLite::Sort<VectorRealType> sort;
+			sort.sort(e, iperm);
+			VectorSizeType better((alive.size() + 1)/2);
+			for (SizeType k = 0; k < better.size(); ++k)
+				better[k] = alive[iperm[k]];
+			alive.swap(better);
+		}
+
+		SizeType best = alive[0];
+		for (SizeType k = 1; k < alive.size(); ++k)
+			if (energies[alive[k]] < energies[best]) best = alive[k];
+
+		angles = x[best];
+		converged = done[best];
+		return used;
+	}
+
+private:
+
+	FunctionType& function_;
+	SizeType starts_;
+}; // class MultiStart
+
+} // namespace Gep
+#endif // MULTISTART_H
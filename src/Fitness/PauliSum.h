@@ -0,0 +1,342 @@
+#ifndef PAULISUM_H
+#define PAULISUM_H
+#include "Vector.h"
+#include "PsimagLite.h"
+#include "Matrix.h"
+#include "Parallelizer2.h"
+#include "SymmetrySector.h"
+#include <map>
+#include <algorithm>
+
+namespace Gep {
+
+/* PSIDOC PauliSum
+A Hamiltonian can also be kept as a sum of Pauli strings, each a coefficient
+times $X^{x}Z^{z}$, where $x$ and $z$ are masks of bits: $X^{x}$ flips the bits
+in $x$, and $Z^{z}$ multiplies a state $|i\rangle$ by $(-1)$ to the number of bits
+set in $i$ and $z$. $Y$ is $iXZ$, and any other one-bit operator of an
+expression is expanded in $I$, $X$, $Z$ and $XZ$. Products of strings follow
+from $Z^{z}X^{x} = (-1)^{|z\wedge x|}X^{x}Z^{z}$. The strings are then grouped by
+$x$: those with $x=0$ add up to a diagonal, kept as a vector, and each other
+group maps $|i\rangle$ to $|i\oplus x\rangle$ with a sign that depends on $i$, so that
+$\langle v|H|v\rangle$ and $H|v\rangle$ are computed from the state vector alone,
+without building a matrix.
+With HamiltonianMatrixFree=1 in the input file, the Hamiltonians xx, zxz
+and those given by expressions are kept this way, so that memory grows
+with $2^N$ for $N$ bits instead of with the nonzeros of $H$.
+Hamiltonians from files are not affected.
+*/
+template<typename ComplexType>
+class PauliSum {
+
+	// the strings with the same x mask
+	struct Group {
+
+		Group(SizeType x_) : x(x_), isReal(true) {}
+
+		SizeType x;
+		bool isReal;
+		PsimagLite::Vector<SizeType>::Type z;
+		typename PsimagLite::Vector<ComplexType>::Type c;
+		// the real parts of c, used if all of c is real
+		typename PsimagLite::Vector<typename PsimagLite::Real<ComplexType>::Type>::Type r;
+	};
+
+public:
+
+	typedef typename PsimagLite::Real<ComplexType>::Type RealType;
+	typedef typename PsimagLite::Vector<ComplexType>::Type VectorType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Matrix<ComplexType> MatrixType;
+	typedef std::pair<SizeType, SizeType> PairSizeType;
+	typedef std::map<PairSizeType, ComplexType> MapType;
+	typedef typename PsimagLite::Vector<Group>::Type VectorGroupType;
+	typedef std::pair<SizeType, ComplexType> PairSizeComplexType;
+	typedef typename PsimagLite::Vector<PairSizeComplexType>::Type VectorPairSizeComplexType;
+	typedef typename PsimagLite::Vector<VectorPairSizeComplexType>::Type
+	VectorVectorPairSizeComplexType;
+	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
+	typedef PsimagLite::Vector<VectorSizeType>::Type VectorVectorSizeType;
+
+	// The zero operator
+	explicit PauliSum(SizeType bits) : bits_(bits) {}
+
+	// The one-bit operator gate on bit, as a I + b X + c Z + d XZ
+	PauliSum(const MatrixType& gate, SizeType bit, SizeType bits) : bits_(bits)
+	{
+		assert(gate.rows() == 2 && gate.cols() == 2);
+		if (bit >= bits)
+			err("PauliSum: bit " + ttos(bit) + " too large\n");
+
+		const SizeType mask = (1 << bit);
+		add(0, 0, 0.5*(gate(0, 0) + gate(1, 1)));
+		add(0, mask, 0.5*(gate(0, 0) - gate(1, 1)));
+		add(mask, 0, 0.5*(gate(0, 1) + gate(1, 0)));
+		add(mask, mask, 0.5*(gate(1, 0) - gate(0, 1)));
+	}
+
+	PauliSum& operator+=(const PauliSum& other)
+	{
+		typename MapType::const_iterator it = other.terms_.begin();
+		for (; it != other.terms_.end(); ++it)
+			add(it->first.first, it->first.second, it->second);
+		return *this;
+	}
+
+	// this = this * other
+	PauliSum& operator*=(const PauliSum& other)
+	{
+		MapType terms;
+		terms.swap(terms_);
+		typename MapType::const_iterator it = terms.begin();
+		for (; it != terms.end(); ++it) {
+			typename MapType::const_iterator it2 = other.terms_.begin();
+			for (; it2 != other.terms_.end(); ++it2) {
+				const SizeType x = it->first.first ^ it2->first.first;
+				const SizeType z = it->first.second ^ it2->first.second;
+				const ComplexType c = it->second*it2->second;
+				// Z^z1 X^x2 = (-1)^|z1 & x2| X^x2 Z^z1
+				add(x, z, (parity(it->first.second & it2->first.first)) ? -c : c);
+			}
+		}
+
+		return *this;
+	}
+
+	PauliSum& operator*=(const ComplexType& scalar)
+	{
+		typename MapType::iterator it = terms_.begin();
+		while (it != terms_.end()) {
+			it->second *= scalar;
+			if (std::norm(it->second) == 0)
+				terms_.erase(it++);
+			else
+				++it;
+		}
+
+		return *this;
+	}
+
+	bool isZero() const { return terms_.empty(); }
+
+	SizeType bits() const { return bits_; }
+
+	const MapType& terms() const { return terms_; }
+
+	// Groups the strings by x mask; call before energy() or matrixVectorProduct()
+	void groupTerms()
+	{
+		const SizeType hilbertSpace = (1 << bits_);
+		diagonal_.clear();
+		groups_.clear();
+
+		typename MapType::const_iterator it = terms_.begin();
+		for (; it != terms_.end(); ++it) {
+			const SizeType x = it->first.first;
+			const SizeType z = it->first.second;
+			if (x == 0) {
+				if (diagonal_.size() == 0) diagonal_.resize(hilbertSpace, 0);
+				for (SizeType i = 0; i < hilbertSpace; ++i)
+					diagonal_[i] += (parity(i & z)) ? -it->second : it->second;
+				continue;
+			}
+
+			if (groups_.size() == 0 || groups_.back().x != x)
+				groups_.push_back(Group(x));
+
+			Group& group = groups_.back();
+			group.z.push_back(z);
+			group.c.push_back(it->second);
+			group.r.push_back(PsimagLite::real(it->second));
+			if (std::imag(it->second) != 0) group.isReal = false;
+		}
+	}
+
+	// <v|H|v>
+	RealType energy(const VectorType& v) const
+	{
+		const SizeType hilbertSpace = v.size();
+		assert(hilbertSpace == (static_cast<SizeType>(1) << bits_));
+		ComplexType e = 0;
+		if (diagonal_.size() > 0) {
+			for (SizeType i = 0; i < hilbertSpace; ++i)
+				e += std::norm(v[i])*diagonal_[i];
+		}
+
+		for (SizeType g = 0; g < groups_.size(); ++g) {
+			const Group& group = groups_[g];
+			if (group.isReal) {
+				for (SizeType i = 0; i < hilbertSpace; ++i)
+					e += signReal(group, i)*(PsimagLite::conj(v[i ^ group.x])*v[i]);
+				continue;
+			}
+
+			for (SizeType i = 0; i < hilbertSpace; ++i)
+				e += PsimagLite::conj(v[i ^ group.x])*sign(group, i)*v[i];
+		}
+
+		return PsimagLite::real(e);
+	}
+
+	// x += H*y
+	void matrixVectorProduct(VectorType& x, const VectorType& y) const
+	{
+		const SizeType hilbertSpace = y.size();
+		assert(x.size() == hilbertSpace);
+		assert(hilbertSpace == (static_cast<SizeType>(1) << bits_));
+		if (diagonal_.size() > 0) {
+			for (SizeType i = 0; i < hilbertSpace; ++i)
+				x[i] += diagonal_[i]*y[i];
+		}
+
+		for (SizeType g = 0; g < groups_.size(); ++g) {
+			const Group& group = groups_[g];
+			if (group.isReal) {
+				for (SizeType i = 0; i < hilbertSpace; ++i)
+					x[i ^ group.x] += signReal(group, i)*y[i];
+				continue;
+			}
+
+			for (SizeType i = 0; i < hilbertSpace; ++i)
+				x[i ^ group.x] += sign(group, i)*y[i];
+		}
+	}
+
+	// Fills matrix with the sum in the full space
+	template<typename SparseMatrixType>
+	void fillCrs(SparseMatrixType& matrix, SizeType threads) const
+	{
+		fillCrs(matrix, threads, SymmetrySector("", bits_));
+	}
+
+	/* Fills matrix with the sum, after groupTerms(), in one pass over the
+	   rows, which are split in as many blocks as threads. Row r has the
+	   diagonal, and, for each group, the column r^x with value sign(group, r^x).
+	   Rows and columns are the states of sector; errs if the sum leaves it */
+	template<typename SparseMatrixType>
+	void fillCrs(SparseMatrixType& matrix, SizeType threads, const SymmetrySector& sector) const
+	{
+		const SizeType hilbertSpace = sector.size();
+		const SizeType blocks = std::max(std::min(threads, hilbertSpace),
+		                                 static_cast<SizeType>(1));
+		const SizeType blockSize = (hilbertSpace + blocks - 1)/blocks;
+		VectorVectorPairSizeComplexType entries(blocks);
+		VectorVectorSizeType counts(blocks);
+		VectorSizeType leaves(blocks, 0);
+
+		PsimagLite::CodeSectionParams codeParams(blocks);
+		PsimagLite::Parallelizer2<> parallelizer2(codeParams);
+		parallelizer2.parallelFor(0,
+		                          blocks,
+		                          [this, &entries, &counts, &leaves, &sector, blockSize, hilbertSpace]
+		                          (SizeType block, SizeType) {
+			const SizeType start = block*blockSize;
+			const SizeType end = std::min(start + blockSize, hilbertSpace);
+			VectorPairSizeComplexType row;
+			for (SizeType r = start; r < end; ++r) {
+				row.clear();
+				const SizeType state = sector.state(r);
+				if (diagonal_.size() > 0 && std::norm(diagonal_[state]) > 0)
+					row.push_back(PairSizeComplexType(r, diagonal_[state]));
+
+				for (SizeType g = 0; g < groups_.size(); ++g) {
+					const Group& group = groups_[g];
+					const SizeType c = state ^ group.x;
+					const ComplexType value = sign(group, c);
+					if (std::norm(value) == 0) continue;
+
+					const SizeType column = sector.index(c);
+					if (column < hilbertSpace)
+						row.push_back(PairSizeComplexType(column, value));
+					else
+						leaves[block] = 1;
+				}
+
+				std::sort(row.begin(), row.end(), lessByColumn);
+				entries[block].insert(entries[block].end(), row.begin(), row.end());
+				counts[block].push_back(row.size());
+			}
+		});
+
+		if (std::find(leaves.begin(), leaves.end(), static_cast<SizeType>(1)) != leaves.end())
+			err("PauliSum::fillCrs(): the Hamiltonian does not conserve SymmetrySector\n");
+
+		matrix.resize(hilbertSpace, hilbertSpace);
+		SizeType counter = 0;
+		SizeType r = 0;
+		for (SizeType block = 0; block < blocks; ++block) {
+			SizeType k = 0;
+			for (SizeType i = 0; i < counts[block].size(); ++i) {
+				matrix.setRow(r++, counter);
+				for (SizeType j = 0; j < counts[block][i]; ++j) {
+					matrix.pushCol(entries[block][k].first);
+					matrix.pushValue(entries[block][k].second);
+					++k;
+				}
+
+				counter += counts[block][i];
+			}
+		}
+
+		assert(r == hilbertSpace);
+		matrix.setRow(hilbertSpace, counter);
+		matrix.checkValidity();
+	}
+
+private:
+
+	static bool lessByColumn(const PairSizeComplexType& a, const PairSizeComplexType& b)
+	{
+		return (a.first < b.first);
+	}
+
+	void add(SizeType x, SizeType z, const ComplexType& c)
+	{
+		if (std::norm(c) == 0) return;
+
+		const PairSizeType key(x, z);
+		typename MapType::iterator it = terms_.find(key);
+		if (it == terms_.end()) {
+			terms_[key] = c;
+			return;
+		}
+
+		it->second += c;
+		if (std::norm(it->second) == 0) terms_.erase(it);
+	}
+
+	// The sum over the strings of group of their coefficients times the signs for state i
+	static ComplexType sign(const Group& group, SizeType i)
+	{
+		ComplexType sum = 0;
+		for (SizeType k = 0; k < group.z.size(); ++k) {
+			const RealType s = 1 - 2*static_cast<int>(parity(i & group.z[k]));
+			sum += s*group.c[k];
+		}
+
+		return sum;
+	}
+
+	// sign() for a group with real coefficients
+	static RealType signReal(const Group& group, SizeType i)
+	{
+		RealType sum = 0;
+		for (SizeType k = 0; k < group.z.size(); ++k)
+			sum += (1 - 2*static_cast<int>(parity(i & group.z[k])))*group.r[k];
+
+		return sum;
+	}
+
+	static bool parity(SizeType mask)
+	{
+		return (__builtin_popcountl(mask) & 1);
+	}
+
+	SizeType bits_;
+	MapType terms_;
+	VectorType diagonal_;
+	VectorGroupType groups_;
+}; // class PauliSum
+
+} // namespace Gep
+#endif // PAULISUM_H
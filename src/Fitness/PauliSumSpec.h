@@ -0,0 +1,46 @@
+#ifndef PAULISUMSPEC_H
+#define PAULISUMSPEC_H
+#include "AuxForHamSpec.h"
+#include "HamiltonianSpec.h"
+#include "PauliSum.h"
+#include "CrsMatrix.h"
+
+namespace Gep {
+
+// Like HamiltonianSpec, but the terms are PauliSums instead of matrices
+template<typename ComplexType>
+class PauliSumSpec {
+
+public:
+
+	typedef ComplexType ComplexOrRealType;
+	typedef AuxForHamSpec AuxiliaryType;
+	typedef PauliSum<ComplexType> ResultType;
+	typedef HamiltonianSpec<PsimagLite::CrsMatrix<ComplexType> > HamiltonianSpecType;
+	typedef typename HamiltonianSpecType::OneBitGateLibraryType OneBitGateLibraryType;
+	typedef typename OneBitGateLibraryType::MatrixType MatrixType;
+
+	ResultType operator()(PsimagLite::String str, AuxiliaryType& aux) const
+	{
+		MatrixType gateMatrix;
+		std::pair<PsimagLite::String, SizeType> nameBitPair =
+		        HamiltonianSpecType::ResultType::extractNameAndBit(str);
+		if (nameBitPair.second >= aux.numberOfBits())
+			err("Bit too large in expression " + ttos(nameBitPair.second));
+
+		OneBitGateLibraryType::fillAnyGate(gateMatrix, nameBitPair.first);
+		return ResultType(gateMatrix, nameBitPair.second, aux.numberOfBits());
+	}
+
+	static bool isEmpty(const ResultType& pauliSum)
+	{
+		return pauliSum.isZero();
+	}
+
+	static bool metaEqual(const ResultType&, const ResultType&)
+	{
+		return true;
+	}
+};
+}
+#endif // PAULISUMSPEC_H
@@ -0,0 +1,295 @@
+#ifndef PREPAREDCIRCUIT_H
+#define PREPAREDCIRCUIT_H
+#include "Vector.h"
+#include "PsimagLite.h"
+#include "PackedGenome.h"
+#include "NodeFactory.h"
+#include <algorithm>
+#include <map>
+
+namespace Gep {
+
+/* PSIDOC PreparedCircuit
+The PreparedCircuit class finds, once per individual, the gates of a quantum circuit
+that have an angle, that is, the rotations and the parametric custom gates, in the
+order of the genome. The minimizers of the quantum fitness classes then bind each
+vector of angles straight into these gates, which recompute their matrices in
+place, so that evaluating the circuit for new angles neither formats nor parses
+strings and does not rebuild the individual. Angles are bound at full precision, and
+rounded to the precision with which individuals are printed only when they are
+stored in the genome.
+
+PreparedCircuit also computes the gradient of a function of the output of the circuit with
+respect to the angles by the adjoint method. The caller gives the output $|\psi\rangle$ and
+a vector $|s\rangle$ such that a change $|d\psi\rangle$ of the output changes the
+function by ${\rm Re}\langle s|d\psi\rangle$. One backward pass through the gates
+undoes each gate $U$ on the output with $U^\dagger$, and propagates $|s\rangle$ with $U^\dagger$,
+so that the derivative with respect to the angle of gate $U$ is
+${\rm Re}\langle s'|\partial U|\psi'\rangle$, where $|s'\rangle$ and $|\psi'\rangle$
+are the propagated vectors after and before that gate. All the derivatives then cost
+about as much as two evaluations of the circuit, but the gates must be unitary.
+Gates that drop the amplitudes they send out of a symmetry sector are not; for
+circuits that lose weight this way, the vectors $|\psi'\rangle$ are instead kept from
+the forward pass, at the cost of one vector per gate.
+
+A copy of a PreparedCircuit owns clones of the gates, so that threads can bind
+different angles to copies of the same circuit at the same time.
+*/
+template<typename ChromosomeType>
+class PreparedCircuit {
+
+public:
+
+	typedef typename ChromosomeType::TreeType TreeType;
+	typedef typename TreeType::NodeType NodeType;
+	typedef typename NodeType::AnglesType RealType;
+	typedef typename NodeType::ValueType VectorType;
+	typedef typename PsimagLite::Vector<VectorType>::Type VectorVectorType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef typename PsimagLite::Vector<const NodeType*>::Type VectorNodeType;
+	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
+
+	PreparedCircuit(const ChromosomeType& chromosome)
+	    : chromosome_(chromosome)
+	{
+		if (chromosome.size() != 1 || chromosome.adfs() != 0)
+			err("PreparedCircuit: expected one gene and no ADFs\n");
+
+		const typename ChromosomeType::GeneType& gene = chromosome.gene(0);
+		const SizeType n = gene.effectiveSize();
+		for (SizeType i = 0; i < n; ++i) {
+			const NodeType& node = gene.tree(i).node();
+			if (node.isInput()) break;
+			gates_.push_back(&node);
+			if (!hasAngle(node.code())) continue;
+			nodes_.push_back(&node);
+			positions_.push_back(i);
+		}
+
+		// the angle that each gate uses after bind(), or none
+		const SizeType gates = gates_.size();
+		owners_.resize(gates, noAngle_);
+		for (SizeType i = 0; i < gates; ++i)
+			for (SizeType j = 0; j < nodes_.size(); ++j)
+				if (nodes_[j] == gates_[i]) owners_[i] = j;
+	}
+
+	// Clones the gates; gates that share a node share its clone
+	PreparedCircuit(const PreparedCircuit& other)
+	    : chromosome_(other.chromosome_),
+	      gates_(other.gates_),
+	      owners_(other.owners_),
+	      nodes_(other.nodes_),
+	      positions_(other.positions_)
+	{
+		std::map<const NodeType*, const NodeType*> clones;
+		const SizeType gates = gates_.size();
+		for (SizeType i = 0; i < gates; ++i) {
+			const NodeType*& clone = clones[gates_[i]];
+			if (!clone) {
+				clone = gates_[i]->clone();
+				owned_.push_back(clone);
+			}
+
+			gates_[i] = clone;
+		}
+
+		const SizeType n = nodes_.size();
+		for (SizeType i = 0; i < n; ++i)
+			nodes_[i] = clones[nodes_[i]];
+	}
+
+	~PreparedCircuit()
+	{
+		const SizeType n = owned_.size();
+		for (SizeType i = 0; i < n; ++i)
+			delete owned_[i];
+	}
+
+	PreparedCircuit& operator=(const PreparedCircuit&) = delete;
+
+	SizeType size() const { return nodes_.size(); }
+
+	/* Binds angles to the gates. Gates with the same code share their node,
+	   so that, as when building the individual, the last angle wins */
+	void bind(const VectorRealType& angles) const
+	{
+		assert(angles.size() == nodes_.size());
+		const SizeType n = nodes_.size();
+		for (SizeType i = 0; i < n; ++i)
+			nodes_[i]->bindAngle(angles[i]);
+	}
+
+	// Binds one angle only
+	void bind(SizeType index, RealType angle) const
+	{
+		assert(index < nodes_.size());
+		nodes_[index]->bindAngle(angle);
+	}
+
+	// The number of gates, and gate i in the order in which gates are applied
+	SizeType gates() const { return gates_.size(); }
+
+	const NodeType& gate(SizeType i) const
+	{
+		assert(i < gates_.size());
+		return *gates_[gates_.size() - 1 - i];
+	}
+
+	// Whether gate i, in the order of application, uses one of the angles, and which
+	bool hasAngleAt(SizeType i) const
+	{
+		assert(i < owners_.size());
+		return (owners_[owners_.size() - 1 - i] != noAngle_);
+	}
+
+	SizeType angleAt(SizeType i) const
+	{
+		assert(hasAngleAt(i));
+		return owners_[owners_.size() - 1 - i];
+	}
+
+	// Whether angle index is of a rotation, and thus periodic with period 2 pi
+	bool isRotation(SizeType index) const
+	{
+		assert(index < nodes_.size());
+		return (nodes_[index]->code()[0] == 'R');
+	}
+
+	// The number of gates that use angle index, which is 0 if a later angle overrides it
+	SizeType uses(SizeType index) const
+	{
+		return std::count(owners_.begin(), owners_.end(), index);
+	}
+
+	// Applies the gates [start, end), in the order of application, to v
+	void apply(VectorType& v, SizeType start, SizeType end) const
+	{
+		assert(start <= end && end <= gates_.size());
+		VectorVectorType args(1);
+		for (SizeType i = start; i < end; ++i) {
+			args[0].swap(v);
+			v = gate(i).exec(args);
+		}
+	}
+
+	/* Adds to dest the gradient, for the bound angles, of a function of the
+	   output psi of the circuit, where a change dpsi of the output changes the
+	   function by Re<seed|dpsi>. Gates are in genome order, the last one applied first */
+	void gradient(VectorRealType& dest, const VectorType& psi, const VectorType& seed) const
+	{
+		assert(dest.size() == nodes_.size());
+		VectorVectorType phi(1, psi);
+		VectorVectorType lambda(1, seed);
+		const SizeType gates = gates_.size();
+		for (SizeType i = 0; i < gates; ++i) {
+			const NodeType& gate = *gates_[i];
+			phi[0] = gate.execAdjoint(phi);
+			if (owners_[i] != noAngle_) {
+				const VectorType dphi = gate.execDerivative(phi);
+				dest[owners_[i]] += PsimagLite::real(lambda[0]*dphi);
+			}
+
+			lambda[0] = gate.execAdjoint(lambda);
+		}
+	}
+
+	/* As gradient(), but from the input of the circuit instead of its output, for
+	   gates that need not be unitary, such as those that drop the amplitudes they
+	   send out of a symmetry sector and that cannot be undone: the state before each
+	   gate is kept from a forward pass, at the cost of one vector per gate */
+	void gradientFromInput(VectorRealType& dest, const VectorType& input, const VectorType& seed) const
+	{
+		assert(dest.size() == nodes_.size());
+		const SizeType gates = gates_.size();
+		VectorVectorType before(gates);
+		VectorVectorType phi(1, input);
+		for (SizeType i = gates; i > 0; --i) {
+			before[i - 1] = phi[0];
+			phi[0] = gates_[i - 1]->exec(phi);
+		}
+
+		VectorVectorType lambda(1, seed);
+		for (SizeType i = 0; i < gates; ++i) {
+			const NodeType& gate = *gates_[i];
+			if (owners_[i] != noAngle_) {
+				phi[0].swap(before[i]);
+				const VectorType dphi = gate.execDerivative(phi);
+				dest[owners_[i]] += PsimagLite::real(lambda[0]*dphi);
+			}
+
+			lambda[0] = gate.execAdjoint(lambda);
+		}
+	}
+
+	/* The angles stored in the genome, or random ones for gates without angle;
+	   returns the number of angles stored in the genome */
+	template<typename SomeRngType>
+	SizeType initAngles(VectorRealType& angles, SomeRngType& rng) const
+	{
+		const PackedGenome& genome = chromosome_.genome();
+		const SizeType n = nodes_.size();
+		angles.resize(n);
+		SizeType inherited = 0;
+		for (SizeType i = 0; i < n; ++i) {
+			const SizeType pos = positions_[i];
+			if (!genome.hasParam(pos)) {
+				angles[i] = 2*M_PI*rng();
+				continue;
+			}
+
+			angles[i] = genome.param(pos);
+			++inherited;
+		}
+
+		return inherited;
+	}
+
+	// The genome of the individual with these angles
+	PackedGenome genome(const VectorRealType& angles) const
+	{
+		assert(angles.size() == positions_.size());
+		PackedGenome genome = chromosome_.genome();
+		const SizeType n = positions_.size();
+		for (SizeType i = 0; i < n; ++i)
+			genome.setParam(positions_[i], printed(angles[i]));
+		return genome;
+	}
+
+	// The codes of the gates with angles, in order
+	PsimagLite::String signature() const
+	{
+		PsimagLite::String str;
+		const SizeType n = nodes_.size();
+		for (SizeType i = 0; i < n; ++i)
+			str += nodes_[i]->code() + " ";
+		return str;
+	}
+
+	static bool hasAngle(const PsimagLite::String& code)
+	{
+		return NodeFactory<NodeType>::hasAngle(code);
+	}
+
+private:
+
+	// The angle as printed and read back
+	static RealType printed(RealType angle)
+	{
+		return PsimagLite::atof(ttos(angle));
+	}
+
+	static const SizeType noAngle_ = static_cast<SizeType>(-1);
+
+	const ChromosomeType& chromosome_;
+	VectorNodeType gates_;
+	VectorSizeType owners_;
+	VectorNodeType nodes_;
+	VectorSizeType positions_;
+	VectorNodeType owned_;
+}; // class PreparedCircuit
+
+template<typename ChromosomeType>
+const SizeType PreparedCircuit<ChromosomeType>::noAngle_;
+} // namespace Gep
+#endif // PREPAREDCIRCUIT_H
@@ -23,6 +23,11 @@ along with evendim. If not, see <http://www.gnu.org/licenses/>.
 #include "BaseFitness.h"
 #include "MersenneTwister.h"
 #include "ProgramGlobals.h"
+#include "PreparedCircuit.h"
+#include "Lbfgs.h"
+#include "MultiStart.h"
+#include "AngleInheritance.h"
+#include "FidelitySchedule.h"
 
 namespace Gep {
 
@@ -37,6 +42,7 @@ public:
 	typedef typename ChromosomeType::VectorStringType VectorStringType;
 	typedef PsimagLite::Matrix<ComplexType> MatrixType;
 	typedef typename EvolutionType::NodeFactoryType NodeFactoryType;
+	typedef PreparedCircuit<ChromosomeType> PreparedCircuitType;
 
 	enum class FunctionEnum {FITNESS, DIFFERENCE};
 
@@ -46,12 +52,13 @@ public:
 	                   SizeType threadNum)
 	    : evolution_(evolution),
 	      chromosome_(chromosome),
+	      circuit_(chromosome),
+	      numberOfAngles_(circuit_.size()),
 	      threadNum_(threadNum),
 	      inMatrix_((1 << evolution.primitives().numberOfBits()), samples),
 	      inVector_(inMatrix_.rows()),
 	      outVector_(inMatrix_.rows())
 	{
-		numberOfAngles_ = findNumberOfAngles(chromosome.effectiveVecString());
 		for (SizeType i = 0; i < inMatrix_.cols(); ++i)
 			fillRandomVector(i);
 	}
@@ -70,48 +77,36 @@ public:
 		return fitness(&angles, FunctionEnum::DIFFERENCE, false);
 	}
 
+	// Gradient of the mean distance by the adjoint method, see PreparedCircuit
 	void df(VectorRealType& dest, const VectorRealType& angles)
 	{
-		VectorStringType vecStr = chromosome_.vecString();
-		encodeAngles(vecStr, angles);
-		const ChromosomeType* chromosome = new ChromosomeType(chromosome_.params(),
-		                                                      evolution_,
-		                                                      vecStr,
-		                                                      threadNum_);
+		circuit_.bind(angles);
 
 		dest.resize(angles.size());
+		std::fill(dest.begin(), dest.end(), 0);
 
 		const SizeType samples = inMatrix_.cols();
-		for (SizeType angleIndex = 0; angleIndex < numberOfAngles_; ++angleIndex) {
-			for (SizeType i = 0; i < samples; ++i) {
-				setInVector(i);
-				evolution_.setInput(0, inVector_, threadNum_);
-				functionF(outVector_, inVector_);
-
-				computeDifferentialVector(differential_, angles, angleIndex);
-
-				const RealType tmp = diffVectorDiff2(chromosome->exec(0),
-				                                     outVector_,
-				                                     differential_);
-				dest[angleIndex] += tmp;
+		const SizeType n = outVector_.size();
+		VectorType seed(n);
+		for (SizeType i = 0; i < samples; ++i) {
+			setInVector(i);
+			evolution_.setInput(0, inVector_, threadNum_);
+			functionF(outVector_, inVector_);
+			const VectorType psi = chromosome_.exec(0);
+
+			// d|out - psi| = -Re<(out - psi)/|out - psi| | dpsi>
+			for (SizeType j = 0; j < n; ++j) {
+				const RealType denom = std::abs(outVector_[j] - psi[j]);
+				seed[j] = (denom == 0) ? 0 : (psi[j] - outVector_[j])/(denom*n*samples);
 			}
 
-			dest[angleIndex] /= samples;
+			circuit_.gradient(dest, psi, seed);
 		}
 	}
 
 	RealType fitness(const VectorRealType* angles, FunctionEnum functionEnum, bool verbose)
 	{
-		const ChromosomeType* chromosome = nullptr;
-
-		VectorStringType vecStr = chromosome_.vecString();
-
-		if (angles) {
-			encodeAngles(vecStr, *angles);
-			chromosome = new ChromosomeType(chromosome_.params(), evolution_, vecStr, threadNum_);
-		} else {
-			chromosome = &chromosome_;
-		}
+		if (angles) circuit_.bind(*angles);
 
 		const SizeType samples = inMatrix_.cols();
 		RealType sum = 0;
@@ -122,75 +117,27 @@ public:
 
 			functionF(outVector_, inVector_);
 
-			const RealType tmp = vectorDiff2(chromosome->exec(0),
+			const RealType tmp = vectorDiff2(chromosome_.exec(0),
 			                                 outVector_);
 			sum += fabs(tmp);
 		}
 
-		if (angles) {
-			delete chromosome;
-			chromosome = nullptr;
-		}
-
 		sum /= samples;
 		return (functionEnum == FunctionEnum::DIFFERENCE) ? sum : 1 - sum;
 	}
 
-	static void encodeAngles(VectorStringType& vecStr, const VectorRealType& angles)
+	// The genome of the individual with these angles
+	PackedGenome genome(const VectorRealType& angles) const
 	{
-		const SizeType n = vecStr.size();
-		SizeType currentIndex = 0;
-		bool flag = true;
-		for (SizeType i = 0; i < n; ++i) {
-
-			if (isInputGate(vecStr[i])) {
-				flag = false;
-				continue;
-			}
-
-			if (numberOfAnglesOneGate(vecStr[i]) == 0 || !flag) continue;
-			PsimagLite::String str = vecStr[i];
-			str = NodeFactoryType::stripPreviousAngleIfAny(str);
-			if (angles.size() < currentIndex)
-				err("encodeAngles: too many angles for rotations in this individual!?\n");
-			str += ":" + ttos(angles[currentIndex++]);
-			vecStr[i] = str;
-		}
-
-		if (currentIndex != angles.size())
-			err("encodeAngles: too few angles for rotations in this individual!?\n");
+		return circuit_.genome(angles);
 	}
 
-	template<typename SomeRngType>
-	static void initAngles(VectorRealType& angles, const VectorStringType& vStr, SomeRngType& rng)
-	{
-		const SizeType n = vStr.size();
-		SizeType currentIndex = 0;
-		for (SizeType i = 0; i < n; ++i) {
-			if (numberOfAnglesOneGate(vStr[i]) == 0) continue;
-			if (angles.size() < currentIndex)
-				err("initAngles: too few angles for individual\n");
-
-			initAngle(angles[currentIndex++], vStr[i], rng);
-		}
-
-		if (angles.size() != currentIndex)
-			err("initAngles: too many angles for individual\n");
-	}
+	PsimagLite::String signature() const { return circuit_.signature(); }
 
 	template<typename SomeRngType>
-	static void initAngle(RealType& angle, PsimagLite::String str, SomeRngType& rng)
+	SizeType initAngles(VectorRealType& angles, SomeRngType& rng) const
 	{
-		typename PsimagLite::String::const_iterator it = std::find(str.begin(),
-		                                                           str.end(),
-		                                                           ':');
-		if (it == str.end()) {
-			angle = 2*M_PI*rng();
-			return;
-		}
-
-		PsimagLite::String angleStr = str.substr(it - str.begin() + 1, str.end() - it - 1);
-		angle = std::stod(angleStr);
+		return circuit_.initAngles(angles, rng);
 	}
 
 private:
@@ -209,30 +156,6 @@ private:
 			inMatrix_(i, jnd) *= factor;
 	}
 
-	static SizeType findNumberOfAngles(const VectorStringType& vstr)
-	{
-		SizeType n = vstr.size();
-
-		SizeType count = 0;
-		for (SizeType i = 0; i < n; ++i) {
-			count += numberOfAnglesOneGate(vstr[i]);
-		}
-
-		return count;
-	}
-
-	static SizeType numberOfAnglesOneGate(PsimagLite::String str)
-	{
-		if (str.length() == 0) return 0;
-		return (str[0] == 'R' || str.substr(0, 2) == "PG") ? 1 : 0;
-	}
-
-	static bool isInputGate(PsimagLite::String str)
-	{
-		if (str.length() == 0) return false;
-		return (str[0] == '0') ? true : false;
-	}
-
 	// Flip the first bit
 	// 0.1*|0000> -0.2|1110>
 	// src[0] = 0.1;   src[14] = -0.2 src[..] = 0
@@ -263,75 +186,6 @@ private:
 		return sum/n;
 	}
 
-	static RealType diffVectorDiff2(const VectorType& v1,
-	                                const VectorType& v2,
-	                                const VectorType& v3)
-	{
-		const SizeType n = v1.size();
-		assert(n == v2.size());
-		assert(n == v3.size());
-		RealType sum = 0;
-		for (SizeType i = 0; i < n; ++i) {
-			RealType denom = std::abs(v2[i] - v1[i]);
-			if (denom == 0) denom = 1;
-			const RealType re1 = PsimagLite::real(v2[i] - v1[i]);
-			const RealType im1 = PsimagLite::imag(v2[i] - v1[i]);
-			sum += (PsimagLite::real(v3[i])*re1 + PsimagLite::imag(v3[i])*im1)/denom;
-		}
-
-		return sum/n;
-	}
-
-	void computeDifferentialVector(VectorType& differential,
-	                               const VectorRealType& angles,
-	                               SizeType angleIndex)
-	{
-		differential.resize(angles.size());
-		std::fill(differential.begin(), differential.end(), 0);
-
-		assert(angles.size() == numberOfAngles_);
-
-		VectorStringType cString = chromosome_.effectiveVecString();
-
-		SizeType geneLength = chromosome_.length();
-
-		VectorStringType tmpString = replaceOneR(cString, angleIndex, geneLength);
-
-		assert(tmpString.size() == geneLength);
-
-		// create derivative individual angle-th
-		ChromosomeType newChromosome(chromosome_.params(), evolution_, tmpString, threadNum_);
-
-		// apply to inVector
-		differential = newChromosome.exec(0);
-	}
-
-	// adds padding as well
-	VectorStringType replaceOneR(VectorStringType& v, SizeType angleIndex, SizeType geneLength)
-	{
-		VectorStringType w(geneLength);
-
-		const SizeType n = v.size();
-		assert(n <= geneLength);
-		SizeType count = 0;
-		for (SizeType i = 0; i < n; ++i) {
-			w[i] = v[i];
-			SizeType n = numberOfAnglesOneGate(v[i]);
-			if (n == 0) continue;
-			if (n == 1) {
-				if (count++ == angleIndex)
-					w[i] = "_" + v[i];
-			}
-		}
-
-		assert(count == numberOfAngles_);
-
-		for (SizeType i = n; i < geneLength; ++i)
-			w[i] = "0";
-
-		return w;
-	}
-
 	void setInVector(SizeType jnd)
 	{
 		const SizeType n = inMatrix_.rows();
@@ -342,12 +196,12 @@ private:
 
 	EvolutionType& evolution_;
 	const ChromosomeType& chromosome_;
-	SizeType threadNum_;
+	PreparedCircuitType circuit_;
 	SizeType numberOfAngles_;
+	SizeType threadNum_;
 	MatrixType inMatrix_;
 	VectorType inVector_;
 	VectorType outVector_;
-	VectorType differential_;
 };
 
 template<typename ChromosomeType>
@@ -367,16 +221,30 @@ public:
 	typedef FunctionToMinimize<ChromosomeType, EvolutionType, ComplexType>
 	FunctionToMinimizeType;
 	typedef typename PsimagLite::Minimizer<RealType, FunctionToMinimizeType> MinimizerType;
+	typedef Lbfgs<FunctionToMinimizeType> LbfgsType;
+	typedef LbfgsWarmStart<typename LbfgsType::PairsType> LbfgsWarmStartType;
+	typedef MultiStart<FunctionToMinimizeType> MultiStartType;
+	typedef FidelitySchedule<RealType> FidelityScheduleType;
 	typedef typename ChromosomeType::VectorStringType VectorStringType;
 
 	QuantumFitness(SizeType samples, EvolutionType& evolution, MinimizerParamsType* minParams)
 	    : samples_(samples),
 	      evolution_(evolution),
 	      minParams_(*minParams),
-	      status_(0)
+	      status_(0),
+	      schedule_(minParams->fidelity, minParams->fidelityGenerations),
+	      resume_(false),
+	      budget_(1)
 	{
 		if (evolution.numberOfInputs() != 1)
 			err("QuantumFitness::ctor(): 1 input expected\n");
+
+		if (minParams_.algo == MinimizerParamsType::ROTOSOLVE)
+			err("QuantumFitness::ctor(): Rotosolve needs RunType=GroundState\n");
+		if (minParams_.algo == MinimizerParamsType::CMAES)
+			err("QuantumFitness::ctor(): CMAES needs RunType=GroundState\n");
+		if (evolution.primitives().sector().isActive())
+			err("QuantumFitness::ctor(): SymmetrySector needs RunType=GroundState\n");
 	}
 
 	RealType getFitness(const ChromosomeType& chromosome,
@@ -394,41 +262,38 @@ public:
 			                 evolution_.verbose());
 		}
 
-		MinimizerType min(f, minParams_.maxIter, minParams_.verbose);
-
-		int used = 0;
 		VectorRealType angles(f.size());
 		PsimagLite::MersenneTwister rng(seed);
-		FunctionToMinimizeType::initAngles(angles, chromosome.effectiveVecString(), rng);
-		if (minParams_.algo == MinimizerParamsType::SIMPLEX) {
-			used = min.simplex(angles,
-			                   minParams_.delta,
-			                   minParams_.tol);
-		} else if (minParams_.algo == MinimizerParamsType::NONE) {
-			used = 1;
-		} else {
-			used = min.conjugateGradient(angles,
-			                             minParams_.delta,
-			                             minParams_.delta2,
-			                             minParams_.tol,
-			                             minParams_.saveEvery);
-		}
-
-		status_ = (min.status() == MinimizerType::GSL_SUCCESS) ? 0 : 1;
-
-		if (status_ == 0) {
-			VectorStringType vecStr = chromosome.vecString();
-			FunctionToMinimizeType::encodeAngles(vecStr, angles);
-			const ChromosomeType* chromosome2 = new ChromosomeType(chromosome.params(),
-			                                                       evolution_,
-			                                                       vecStr,
-			                                                       threadNum);
+		const SizeType inherited = f.initAngles(angles, rng);
+		if (evolution_.angleGrid() > 0) return gridFitness(f, angles, threadNum);
+
+		// resumed rounds of a race go on from the best start so far
+		MultiStartType multiStart(f, (resume_) ? 1 : minParams_.starts);
+		bool converged = false;
+		int used = multiStart(converged,
+		                      angles,
+		                      maxIter(),
+		                      seed + 1, // not the seed of initAngles
+		                      [&f, threadNum, this](bool& convergedOne,
+		                                            VectorRealType& x,
+		                                            SizeType iterations) {
+			return minimize(convergedOne, x, f, iterations, threadNum);
+		});
+
+		status_ = (converged) ? 0 : 1;
+		if (minParams_.inheritAngles && !inheritance_.isMinimized(chromosome.genome()))
+			inheritance_.add(threadNum, inherited, angles.size(), used);
+
+		// rounds of a race keep their angles, to be resumed by the next round
+		if (status_ == 0 || resume_ || budget_ < 1 || minParams_.inheritAngles) {
+			const ChromosomeType chromosome2(chromosome.params(),
+			                                 evolution_,
+			                                 f.genome(angles),
+			                                 threadNum);
+			if (minParams_.inheritAngles) inheritance_.minimized(chromosome2.genome());
 
 			ChromosomeType& chromosomeNonconst = const_cast<ChromosomeType&>(chromosome);
-			chromosomeNonconst = *chromosome2;
-
-			delete chromosome2;
-			chromosome2 = nullptr;
+			chromosomeNonconst = chromosome2;
 		}
 
 		const bool printFooter = minParams_.verbose;
@@ -437,11 +302,12 @@ public:
 		RealType value = f.fitness(&angles,
 		                           FunctionToMinimizeType::FunctionEnum::FITNESS,
 		                           evolution_.verbose());
+		schedule_.record(threadNum, value);
 
 		if (!printFooter) return value; // <--- EARLY EXIT HERE
 
 		std::cerr<<"QuantumFitness::minimize(): ";
-		if (min.status() == MinimizerType::GSL_SUCCESS) {
+		if (converged) {
 			std::cerr<<" converged after ";
 		} else {
 			std::cerr<<"NOT CONVERGED after ";
@@ -455,6 +321,29 @@ public:
 
 	RealType maxFitness() const { return samples_; }
 
+	void startGeneration(SizeType generation)
+	{
+		warmStart_.startGeneration();
+		if (minParams_.inheritAngles && generation > 0)
+			inheritance_.print(std::cerr, generation - 1);
+
+		inheritance_.startGeneration();
+
+		schedule_.startGeneration();
+	}
+
+	RealType fidelity() const { return schedule_(); }
+
+	void setFullFidelity(bool full) { schedule_.setFull(full); }
+
+	RealType racingBudget() const { return minParams_.racing; }
+
+	void setRacingRound(SizeType round, RealType budget)
+	{
+		resume_ = (round > 0);
+		budget_ = budget;
+	}
+
 private:
 
 	static PsimagLite::String toString(const VectorRealType& angles)
@@ -466,10 +355,75 @@ private:
 		return str;
 	}
 
+	// Angles on a grid are not minimized; see AngleGrid
+	RealType gridFitness(FunctionToMinimizeType& f, VectorRealType& angles, SizeType threadNum)
+	{
+		for (SizeType i = 0; i < angles.size(); ++i)
+			angles[i] = evolution_.nearestGridAngle(angles[i]);
+
+		status_ = 0;
+		const RealType value = f.fitness(&angles,
+		                                 FunctionToMinimizeType::FunctionEnum::FITNESS,
+		                                 evolution_.verbose());
+		schedule_.record(threadNum, value);
+		return value;
+	}
+
+	// The iterations that the minimizer may use in this round of racing, at this fidelity
+	SizeType maxIter() const
+	{
+		const RealType iterations = minParams_.maxIter*budget_*schedule_();
+		return std::max(static_cast<SizeType>(iterations + 0.5), static_cast<SizeType>(1));
+	}
+
+	RealType tol() const { return minParams_.tol/schedule_(); }
+
+	// Minimizes angles with up to maxIter iterations, and returns the iterations used
+	int minimize(bool& converged,
+	             VectorRealType& angles,
+	             FunctionToMinimizeType& f,
+	             SizeType maxIter,
+	             SizeType threadNum)
+	{
+		if (minParams_.algo == MinimizerParamsType::LBFGS)
+			return LbfgsType::minimize(converged,
+			                           angles,
+			                           f,
+			                           maxIter,
+			                           tol(),
+			                           minParams_,
+			                           warmStart_,
+			                           threadNum);
+
+		MinimizerType min(f, maxIter, minParams_.verbose);
+		int used = 0;
+		if (minParams_.algo == MinimizerParamsType::SIMPLEX) {
+			used = min.simplex(angles,
+			                   minParams_.delta,
+			                   tol());
+		} else if (minParams_.algo == MinimizerParamsType::NONE) {
+			used = 1;
+		} else {
+			used = min.conjugateGradient(angles,
+			                             minParams_.delta,
+			                             minParams_.delta2,
+			                             tol(),
+			                             minParams_.saveEvery);
+		}
+
+		converged = (min.status() == MinimizerType::GSL_SUCCESS);
+		return used;
+	}
+
 	SizeType samples_;
 	EvolutionType& evolution_;
 	const MinimizerParamsType minParams_;
 	int status_;
+	LbfgsWarmStartType warmStart_;
+	AngleInheritance inheritance_;
+	FidelityScheduleType schedule_;
+	bool resume_;
+	RealType budget_;
 }; // class QuantumFitness
 } // namespace Gep
 
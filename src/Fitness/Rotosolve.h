@@ -0,0 +1,148 @@
+#ifndef ROTOSOLVE_H
+#define ROTOSOLVE_H
+#include "Vector.h"
+#include "PsimagLite.h"
+
+namespace Gep {
+
+/* PSIDOC Rotosolve
+When MinimizerAlgorithm=``Rotosolve'' in the input file, which is only supported
+for RunType=``GroundState'', the angles are minimized one at a time, in sweeps
+over the circuit. A rotation $U(\theta)$ equals $\cos(\theta/2)U(0) + \sin(\theta/2)U(\pi)$, so that,
+if $|a\rangle$ and $|b\rangle$ are the outputs of the circuit with $U(0)$ and
+with $U(\pi)$, the energy as a function of $\theta$ is the sinusoid
+\[
+\frac{H_{aa}+H_{bb}}{2} + \frac{H_{aa}-H_{bb}}{2}\cos\theta + {\rm Re}(H_{ab})\sin\theta,
+\]
+whose minimum is found in closed form. The state before each gate is carried along
+the sweep, so that only the gates after the rotation are applied, twice,
+for each angle. An angle of a gate that appears more than once in the circuit, and
+thus shares its angle with the other copies, or of a parametric custom gate, is
+minimized instead from the energies of the whole circuit at $\theta$ and
+$\theta\pm\pi/2$, and kept only if the energy decreases. The sweeps stop when a sweep
+no longer lowers the energy, or after MinimizerMaxIterations sweeps;
+MinimizerDelta and MinimizerTolerance are not used.
+*/
+template<typename FunctionType>
+class Rotosolve {
+
+public:
+
+	typedef typename FunctionType::FieldType RealType;
+	typedef typename FunctionType::ComplexType ComplexType;
+	typedef typename FunctionType::VectorType VectorType;
+	typedef typename FunctionType::PreparedCircuitType PreparedCircuitType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+	Rotosolve(FunctionType& function, SizeType maxIter, bool verbose)
+	    : function_(function),
+	      circuit_(function.circuit()),
+	      maxIter_(maxIter),
+	      verbose_(verbose),
+	      converged_(false)
+	{}
+
+	bool converged() const { return converged_; }
+
+	// Minimizes starting at angles, and returns the number of sweeps
+	int minimize(VectorRealType& angles)
+	{
+		converged_ = false;
+		RealType e = function_(angles);
+		SizeType iter = 0;
+		for (; iter < maxIter_; ++iter) {
+			const RealType eNew = sweep(angles, e);
+			const RealType gain = e - eNew;
+			e = eNew;
+			if (verbose_)
+				std::cerr<<"Rotosolve: sweep= "<<iter<<" energy= "<<e<<"\n";
+
+			if (gain <= 1e-9*std::max(fabs(e), static_cast<RealType>(1))) {
+				converged_ = true;
+				break;
+			}
+		}
+
+		return iter;
+	}
+
+private:
+
+	// One sweep over the gates, in order of application; returns the new energy
+	RealType sweep(VectorRealType& angles, RealType e)
+	{
+		circuit_.bind(angles);
+		const SizeType gates = circuit_.gates();
+		VectorType phi = function_.inVector();
+		VectorType a;
+		VectorType b;
+		for (SizeType i = 0; i < gates; ++i) {
+			if (!circuit_.hasAngleAt(i)) {
+				circuit_.apply(phi, i, i + 1);
+				continue;
+			}
+
+			const SizeType k = circuit_.angleAt(i);
+			if (!isExact(k, i)) {
+				e = minimizeByEnergies(angles, k, e);
+				phi = function_.inVector();
+				circuit_.apply(phi, 0, i + 1);
+				continue;
+			}
+
+			a = phi;
+			circuit_.bind(k, 0);
+			circuit_.apply(a, i, gates);
+			b = phi;
+			circuit_.bind(k, M_PI);
+			circuit_.apply(b, i, gates);
+
+			const RealType haa = PsimagLite::real(function_.expectation(a, a));
+			const RealType hbb = PsimagLite::real(function_.expectation(b, b));
+			const RealType hab = PsimagLite::real(function_.expectation(a, b));
+			const RealType p = 0.5*(haa - hbb);
+			const RealType q = hab;
+			RealType theta = atan2(-q, -p);
+			if (theta < 0) theta += 2*M_PI;
+
+			angles[k] = theta;
+			circuit_.bind(k, theta);
+			e = 0.5*(haa + hbb) - sqrt(p*p + q*q);
+			circuit_.apply(phi, i, i + 1);
+		}
+
+		return function_(angles);
+	}
+
+	// Whether angle k is of a rotation, gate i, that no other gate shares
+	bool isExact(SizeType k, SizeType i) const
+	{
+		return (circuit_.uses(k) == 1 && circuit_.gate(i).code()[0] == 'R');
+	}
+
+	// The closed form for A sin(theta + B) + C from three energies
+	RealType minimizeByEnergies(VectorRealType& angles, SizeType k, RealType e)
+	{
+		const RealType theta = angles[k];
+		angles[k] = theta + 0.5*M_PI;
+		const RealType ePlus = function_(angles);
+		angles[k] = theta - 0.5*M_PI;
+		const RealType eMinus = function_(angles);
+		angles[k] = theta - 0.5*M_PI - atan2(2*e - ePlus - eMinus, ePlus - eMinus);
+		const RealType eNew = function_(angles);
+		if (eNew < e) return eNew;
+
+		angles[k] = theta;
+		circuit_.bind(angles);
+		return e;
+	}
+
+	FunctionType& function_;
+	const PreparedCircuitType& circuit_;
+	SizeType maxIter_;
+	bool verbose_;
+	bool converged_;
+}; // class Rotosolve
+
+} // namespace Gep
+#endif // ROTOSOLVE_H
@@ -10,10 +10,13 @@ public:
 
 	typedef PsimagLite::Vector<PsimagLite::String>::Type VectorStringType;
 
+	// The engine skips the canonical forms that do nothing
+	static const bool isEmpty = true;
+
 	template<typename T>
 	CanonicalFormEmpty(const VectorStringType&, const T&) {}
 
-	void changeIfNeeded(VectorStringType&) const {}
+	bool changeIfNeeded(VectorStringType&) const { return false; }
 
 };
 }
@@ -28,6 +28,8 @@ public:
 
 	enum class RotationEnum {INVALID, X, Y, Z};
 
+	static const bool isEmpty = false;
+
 	CanonicalFormQuantum(const VectorStringType& data,
 	                     const NodeFactorType& nodeFactory)
 	    : data_(data), nodeFactory_(nodeFactory), needsChange_(false)
@@ -37,15 +39,18 @@ public:
 		needsChange_ |= compactifyRotations(effective_, junkDna_);
 	}
 
-	void changeIfNeeded(VectorStringType& vstr) const
+	// Returns true if vstr was changed
+	bool changeIfNeeded(VectorStringType& vstr) const
 	{
-		if (!needsChange_) return;
+		if (!needsChange_) return false;
 		vstr.resize(effective_.size() + junkDna_.size());
 		for (SizeType i = 0; i < effective_.size(); ++i)
 			vstr[i] = effective_[i];
 
 		for (SizeType i = 0; i < junkDna_.size(); ++i)
 			vstr[i + effective_.size()] = junkDna_[i];
+
+		return true;
 	}
 
 private:
@@ -54,6 +54,13 @@ public:
 			angle = PsimagLite::atof(tokens[1]);
 		}
 
+		evaluate(matrix, name, angle);
+	}
+
+	// name without the angle
+	void evaluate(MatrixType& matrix, const std::string& name, double angle) const
+	{
+		assert(name.substr(0, 2) == "PG");
 		SizeType index = indices_.at(name);
 		assert(index < symbolicMatrices_.size());
 		const PsimagLite::Matrix<PsimagLite::String>& symbolicMatrix = symbolicMatrices_[index];
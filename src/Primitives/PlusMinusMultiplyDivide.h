@@ -87,6 +87,9 @@ public:
 
 	const VectorStringType& dcArray() const { return dcArray_; }
 
+	// No symbol has an angle
+	SizeType angleGrid() const { return 0; }
+
 	const VectorNodeType& nodesSerial() const
 	{
 		return nodes_;
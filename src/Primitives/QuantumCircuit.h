@@ -21,6 +21,7 @@ along with evendim. If not, see <http://www.gnu.org/licenses/>.
 #include <cassert>
 #include "QuantumOneBitGate.h"
 #include "QuantumTwoBitGate.h"
+#include "QuantumGivensGate.h"
 #include "MersenneTwister.h"
 #include "QuantumInput.h"
 #include <numeric>
@@ -32,6 +33,16 @@ along with evendim. If not, see <http://www.gnu.org/licenses/>.
 
 namespace Gep {
 
+/* PSIDOC AngleGrid
+With AngleGrid=$k$ in the input file, the angles of the rotations and of the parametric
+custom gates are restricted to the grid $2\pi j/k$, for $j=0,\ldots,k-1$, so that, for example,
+$k=8$ gives the multiples of $\pi/4$ of the Clifford+T gates. Each new gate of an individual
+gets a random angle of the grid, stored in the genome as any other angle, and a mutation of a
+gate with an angle moves its angle one step of the grid up or down, half of the
+time, instead of replacing the gate. The angles are then not minimized: the fitness of an
+individual is that of its circuit with the angles of its genome, which costs one execution of
+the circuit. AngleGrid=0, the default, leaves the angles continuous.
+*/
 template<typename ValueType_>
 class QuantumCircuit {
 
@@ -54,6 +65,7 @@ public:
 	typedef ValueType_ ValueType;
 	typedef QuantumOneBitGate<VectorValueType> QuantumOneBitGateType;
 	typedef QuantumTwoBitGate<VectorValueType> QuantumTwoBitGateType;
+	typedef QuantumGivensGate<VectorValueType> QuantumGivensGateType;
 	typedef typename QuantumOneBitGateType::MatrixType MatrixType;
 	typedef OneBitGateLibrary<typename ValueType::value_type> OneBitGateLibraryType;
 	typedef TwoBitGateLibrary<typename ValueType::value_type> TwoBitGateLibraryType;
@@ -66,10 +78,28 @@ public:
 	QuantumCircuit(SizeType numberOfBits,
 	               PsimagLite::String gates,
 	               InputNgReadableType& io)
-	    : numberOfBits_(numberOfBits), io_(io)
+	    : numberOfBits_(numberOfBits), io_(io), angleGrid_(0)
 	{
 		PsimagLite::split(gates_, gates, ",");
 
+		try {
+			io.readline(angleGrid_, "AngleGrid=");
+		} catch (std::exception&) {}
+
+		PsimagLite::String sector;
+		try {
+			io.readline(sector, "SymmetrySector=");
+		} catch (std::exception&) {}
+
+		sector_ = SymmetrySector(sector, numberOfBits_);
+		QuantumOneBitGateType::setSector(sector_);
+		QuantumTwoBitGateType::setSector(sector_);
+		QuantumGivensGateType::setSector(sector_);
+
+		// the other gates either keep each state or send it out of the sector
+		if (sector_.isActive() && std::find(gates_.begin(), gates_.end(), "G") == gates_.end())
+			err("SymmetrySector needs the gate G in Primitives=, to mix the states of the sector\n");
+
 		makeNodes(nodes_);
 	}
 
@@ -92,6 +122,12 @@ public:
 
 	SizeType numberOfBits() const { return numberOfBits_; }
 
+	// The number of angles of the grid, or 0 for continuous angles; see AngleGrid
+	SizeType angleGrid() const { return angleGrid_; }
+
+	// The symmetry sector the gates act on; see SymmetrySector
+	const SymmetrySector& sector() const { return sector_; }
+
 private:
 
 	void makeNodes(VectorNodeType& nodes)
@@ -196,6 +232,18 @@ private:
 			}
 		}
 
+		it = std::find(tmpGates.begin(), tmpGates.end(), "G");
+		if (it != tmpGates.end()) {
+			tmpGates.erase(it);
+			// add Givens gates; see QuantumGivensGate
+			for (SizeType i = 0; i < numberOfBits_; ++i) {
+				for (SizeType j = i + 1; j < numberOfBits_; ++j) {
+					NodeType* givens = new QuantumGivensGateType(i, j, numberOfBits_);
+					nodes.push_back(givens);
+				}
+			}
+		}
+
 		customGates(nodes, tmpGates);
 
 		if (tmpGates.size() > 0) {
@@ -273,6 +321,8 @@ private:
 
 	const SizeType numberOfBits_;
 	InputNgReadableType& io_;
+	SizeType angleGrid_;
+	SymmetrySector sector_;
 	CustomQuantumGatesType customQuantumGates_;
 	VectorValueType dcValues_;
 	VectorStringType dcArray_;
@@ -0,0 +1,146 @@
+#ifndef QUANTUM_GIVENS_GATE_H
+#define QUANTUM_GIVENS_GATE_H
+#include "Node.h"
+#include "SymmetrySector.h"
+#include <cmath>
+
+namespace Gep {
+
+/* The gate Gi_j:t rotates by t the states that have bits i and j different,
+   and leaves the others alone: with a the state with bit i set and bit j not,
+   and b the state a with both bits flipped,
+   a goes to cos(t)a + sin(t)b, and b goes to -sin(t)a + cos(t)b.
+   It conserves the number of bits set, and so it mixes the states of a
+   SymmetrySector without sending amplitudes out of it */
+template<typename VectorValueType>
+class QuantumGivensGate : public Node<VectorValueType,
+        typename PsimagLite::Real<typename VectorValueType::value_type::value_type>::Type> {
+
+public:
+
+	typedef typename VectorValueType::value_type ValueType;
+	typedef typename ValueType::value_type ComplexOrRealType;
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+	typedef Node<VectorValueType, RealType> NodeType;
+	typedef typename NodeType::VectorAnglesType VectorAnglesType;
+
+	QuantumGivensGate(SizeType bitNumber1,
+	                  SizeType bitNumber2,
+	                  SizeType numberOfBits)
+	    : code_("G"),
+	      bitNumber1_(bitNumber1),
+	      bitNumber2_(bitNumber2),
+	      angle_(0)
+	{
+		code_ += ttos(bitNumber1);
+		code_ += "_";
+		code_ += ttos(bitNumber2);
+
+		numberOfBits_ = numberOfBits;
+	}
+
+	QuantumGivensGate* clone() const
+	{
+		return new QuantumGivensGate(*this);
+	}
+
+	virtual PsimagLite::String code() const { return code_; }
+
+	virtual SizeType arity() const { return 1; }
+
+	virtual ValueType exec(const VectorValueType& v,
+	                       const VectorAnglesType*,
+	                       SizeType&) const
+	{
+		return exec(v);
+	}
+
+	virtual ValueType exec(const VectorValueType& v) const
+	{
+		return apply(v, cos(angle_), sin(angle_), 1);
+	}
+
+	// The adjoint is the rotation by -angle
+	virtual ValueType execAdjoint(const VectorValueType& v) const
+	{
+		return apply(v, cos(angle_), -sin(angle_), 1);
+	}
+
+	// Uses the angle of the last bindAngle(); states with equal bits go to zero
+	virtual ValueType execDerivative(const VectorValueType& v) const
+	{
+		return apply(v, -sin(angle_), cos(angle_), 0);
+	}
+
+	// str is the code of the gate, with the angle after a colon, if any
+	void setAngle(PsimagLite::String str) const
+	{
+		const long unsigned int ind = str.find(":");
+		angle_ = (ind == PsimagLite::String::npos)
+		        ? 0
+		        : PsimagLite::atof(str.substr(ind + 1, str.length() - ind - 1));
+	}
+
+	void bindAngle(const RealType& angle) const
+	{
+		angle_ = angle;
+	}
+
+	// Vectors hold only the states of sector, if active; see SymmetrySector
+	static void setSector(const SymmetrySector& sector)
+	{
+		sector_ = &sector;
+	}
+
+private:
+
+	/* Sends a to c*a + s*b, b to -s*a + c*b, and the states with equal bits
+	   to other times themselves */
+	ValueType apply(const VectorValueType& v, RealType c, RealType s, RealType other) const
+	{
+		assert(v.size() == 1);
+
+		const ValueType& vv = v[0];
+		const bool inSector = (sector_ && sector_->isActive());
+		const SizeType n = vv.size();
+		assert(inSector || n == (static_cast<SizeType>(1) << numberOfBits_));  // 2^N
+
+		const SizeType mask1 = (static_cast<SizeType>(1) << bitNumber1_);
+		const SizeType mask2 = (static_cast<SizeType>(1) << bitNumber2_);
+		ValueType w(n);
+		for (SizeType i = 0; i < n; ++i) {
+			const SizeType state = (inSector) ? sector_->state(i) : i;
+			const bool bit1 = (state & mask1);
+			const bool bit2 = (state & mask2);
+			if (bit1 == bit2) {
+				w[i] += other*vv[i];
+				continue;
+			}
+
+			// the partner has the same number of bits set, and so is in the sector
+			const SizeType partner = state ^ (mask1 | mask2);
+			const SizeType j = (inSector) ? sector_->index(partner) : partner;
+			assert(j < n);
+			w[i] += c*vv[i];
+			w[j] += (bit1) ? s*vv[i] : -s*vv[i];
+		}
+
+		return w;
+	}
+
+	static SizeType numberOfBits_;
+	static SymmetrySector const* sector_;
+	PsimagLite::String code_;
+	SizeType bitNumber1_;
+	SizeType bitNumber2_;
+	mutable RealType angle_;
+}; // class QuantumGivensGate
+
+template<typename T>
+SizeType QuantumGivensGate<T>::numberOfBits_ = 0;
+
+template<typename T>
+SymmetrySector const* QuantumGivensGate<T>::sector_ = nullptr;
+}
+
+#endif // QUANTUM_GIVENS_GATE_H
@@ -3,6 +3,7 @@
 #include "Node.h"
 #include "Matrix.h"
 #include "CustomQuantumGates.hh"
+#include "SymmetrySector.h"
 
 namespace Gep {
 
@@ -223,7 +224,8 @@ public:
 	                  const MatrixType& gateMatrix)
 	    : code_(cr),
 	      bitNumber_(bitNumber),
-	      gateMatrix_(gateMatrix)
+	      gateMatrix_(gateMatrix),
+	      angle_(0)
 	{
 		code_ += ttos(bitNumber);
 		numberOfBits_ = numberOfBits;
@@ -240,23 +242,37 @@ public:
 
 	virtual ValueType exec(const VectorValueType& v) const
 	{
-		assert(v.size() == 1);
-
-		const ValueType& vv = v[0];
-		const int n = vv.size();
-		assert(n == (1 << numberOfBits_));  // 2^N
+		return apply(gateMatrix_, v, false);
+	}
 
-		ValueType w(n);
+	virtual ValueType execAdjoint(const VectorValueType& v) const
+	{
+		return apply(gateMatrix_, v, true);
+	}
 
-		for (int i = 0; i < n; ++i) {
-			SizeType j = findBasisState(i);
-			SizeType bitI = getBitForIndex(i);
-			SizeType bitJ = getBitForIndex(j);
-			w[i] += gateMatrix_(bitI, bitI)*vv[i];
-			w[j] += gateMatrix_(bitI, bitJ)*vv[i];
+	// Uses the angle of the last bindAngle()
+	virtual ValueType execDerivative(const VectorValueType& v) const
+	{
+		MatrixType diffMatrix;
+		if (code_[0] == 'R') {
+			const SizeType dir = OneBitGateLibraryType::directionCharToInteger(code_[1]);
+			OneBitGateLibraryType::diffRotation(diffMatrix, dir, angle_);
+		} else if (code_.substr(0, 2) == "PG") {
+			// central differences, as custom gates are only known symbolically
+			const RealType h = 1e-5;
+			const PsimagLite::String name = deleteSiteNoColon(code_);
+			MatrixType plus;
+			assert(customOneBitGate_);
+			customOneBitGate_->evaluate(plus, name, angle_ + h);
+			customOneBitGate_->evaluate(diffMatrix, name, angle_ - h);
+			for (SizeType i = 0; i < 2; ++i)
+				for (SizeType j = 0; j < 2; ++j)
+					diffMatrix(i, j) = (plus(i, j) - diffMatrix(i, j))/(2*h);
+		} else {
+			err("Gate " + code_ + " has no angle\n");
 		}
 
-		return w;
+		return apply(diffMatrix, v, false);
 	}
 
 	void setAngle(PsimagLite::String str) const
@@ -265,11 +281,35 @@ public:
 		OneBitGateLibraryType::fillAnyGate(gateMatrix_, str2, customOneBitGate_);
 	}
 
+	// Recomputes the gate matrix in place, without going through the string form
+	void bindAngle(const RealType& angle) const
+	{
+		angle_ = angle;
+		if (code_[0] == 'R') {
+			const SizeType dir = OneBitGateLibraryType::directionCharToInteger(code_[1]);
+			OneBitGateLibraryType::rotation(gateMatrix_, dir, angle);
+		} else if (code_.substr(0, 2) == "_R") {
+			const SizeType dir = OneBitGateLibraryType::directionCharToInteger(code_[2]);
+			OneBitGateLibraryType::diffRotation(gateMatrix_, dir, angle);
+		} else if (code_.substr(0, 2) == "PG") {
+			assert(customOneBitGate_);
+			customOneBitGate_->evaluate(gateMatrix_, deleteSiteNoColon(code_), angle);
+		} else {
+			err("Gate " + code_ + " has no angle\n");
+		}
+	}
+
 	static void setCustom(const CustomQuantumGatesType& customQuantumGates)
 	{
 		customOneBitGate_ = &customQuantumGates;
 	}
 
+	// Vectors hold only the states of sector, if active; see SymmetrySector
+	static void setSector(const SymmetrySector& sector)
+	{
+		sector_ = &sector;
+	}
+
 private:
 
 	static PsimagLite::String deleteSite(PsimagLite::String str)
@@ -305,6 +345,59 @@ private:
 		return str.substr(0, ll);
 	}
 
+	// The gate acts with the transpose of matrix on the bit, or with its adjoint
+	ValueType apply(const MatrixType& matrix, const VectorValueType& v, bool adjoint) const
+	{
+		assert(v.size() == 1);
+
+		const ValueType& vv = v[0];
+		if (sector_ && sector_->isActive()) return applyInSector(matrix, vv, adjoint);
+
+		const int n = vv.size();
+		assert(n == (1 << numberOfBits_));  // 2^N
+
+		ValueType w(n);
+
+		for (int i = 0; i < n; ++i) {
+			SizeType j = findBasisState(i);
+			SizeType bitI = getBitForIndex(i);
+			SizeType bitJ = getBitForIndex(j);
+			if (adjoint) {
+				w[i] += PsimagLite::conj(matrix(bitI, bitI))*vv[i];
+				w[j] += PsimagLite::conj(matrix(bitJ, bitI))*vv[i];
+			} else {
+				w[i] += matrix(bitI, bitI)*vv[i];
+				w[j] += matrix(bitI, bitJ)*vv[i];
+			}
+		}
+
+		return w;
+	}
+
+	// apply() for vectors in the sector; amplitudes sent out of it are dropped
+	ValueType applyInSector(const MatrixType& matrix, const ValueType& vv, bool adjoint) const
+	{
+		const SizeType n = vv.size();
+		assert(n == sector_->size());
+
+		ValueType w(n);
+		for (SizeType i = 0; i < n; ++i) {
+			const SizeType state = sector_->state(i);
+			const SizeType bitI = getBitForIndex(state);
+			const SizeType bitJ = 1 - bitI;
+			const SizeType j = sector_->index(findBasisState(state));
+			if (adjoint) {
+				w[i] += PsimagLite::conj(matrix(bitI, bitI))*vv[i];
+				if (j < n) w[j] += PsimagLite::conj(matrix(bitJ, bitI))*vv[i];
+			} else {
+				w[i] += matrix(bitI, bitI)*vv[i];
+				if (j < n) w[j] += matrix(bitI, bitJ)*vv[i];
+			}
+		}
+
+		return w;
+	}
+
 	SizeType findBasisState(SizeType ind) const
 	{
 		const SizeType mask = (1 << bitNumber_);
@@ -352,9 +445,11 @@ private:
 
 	static SizeType numberOfBits_;
 	static CustomQuantumGatesType const* customOneBitGate_;
+	static SymmetrySector const* sector_;
 	mutable PsimagLite::String code_;
 	SizeType bitNumber_;
 	mutable MatrixType gateMatrix_;
+	mutable RealType angle_;
 }; // class QuantumOneBitGate
 
 template<typename T>
@@ -362,6 +457,9 @@ SizeType QuantumOneBitGate<T>::numberOfBits_ = 0;
 
 template<typename T>
 typename QuantumOneBitGate<T>::CustomQuantumGatesType const* QuantumOneBitGate<T>::customOneBitGate_ = nullptr;
+
+template<typename T>
+SymmetrySector const* QuantumOneBitGate<T>::sector_ = nullptr;
 }
 
 #endif // QUANTUM_ONE_BIT_GATES_H
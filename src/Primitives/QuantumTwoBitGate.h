@@ -2,6 +2,7 @@
 #define QUANTUM_TWO_BIT_GATE_H
 #include "Node.h"
 #include "Matrix.h"
+#include "SymmetrySector.h"
 
 namespace Gep {
 
@@ -71,29 +72,55 @@ public:
 		assert(v.size() == 1);
 
 		const ValueType& vv = v[0];
+		const bool inSector = (sector_ && sector_->isActive());
 		const int n = vv.size();
-		assert(n == (1 << numberOfBits_));  // 2^N
+		assert(inSector || n == (1 << numberOfBits_));  // 2^N
 
 		ValueType w(n);
-		const SizeType mask2 = (1 << bitNumber2_);
 		for (int i = 0; i < n; ++i) {
-			const SizeType oldContent1 = getBitForIndex(i, bitNumber1_);
-			assert(oldContent1 < 2);
-			const SizeType oldContent2 = getBitForIndex(i, bitNumber2_);
-			assert(oldContent2 < 2);
-			const SizeType content2 = (oldContent1 + oldContent2) % 2;
-			assert(content2 < 2);
-
-			const SizeType j = (content2 == oldContent2) ? i : (i ^ mask2);
-
-			w[j] += vv[i];
+			const SizeType state = (inSector) ? sector_->state(i) : i;
+			const SizeType j = target(state);
+			if (!inSector) {
+				w[j] += vv[i];
+				continue;
+			}
+
+			// amplitudes sent out of the sector are dropped
+			const SizeType jj = sector_->index(j);
+			if (jj < static_cast<SizeType>(n)) w[jj] += vv[i];
 		}
 
 		return w;
 	}
 
+	// The gate is a permutation that is its own inverse
+	virtual ValueType execAdjoint(const VectorValueType& v) const
+	{
+		return exec(v);
+	}
+
+	// Vectors hold only the states of sector, if active; see SymmetrySector
+	static void setSector(const SymmetrySector& sector)
+	{
+		sector_ = &sector;
+	}
+
 private:
 
+	// The state to which the gate sends state i
+	SizeType target(SizeType i) const
+	{
+		const SizeType mask2 = (1 << bitNumber2_);
+		const SizeType oldContent1 = getBitForIndex(i, bitNumber1_);
+		assert(oldContent1 < 2);
+		const SizeType oldContent2 = getBitForIndex(i, bitNumber2_);
+		assert(oldContent2 < 2);
+		const SizeType content2 = (oldContent1 + oldContent2) % 2;
+		assert(content2 < 2);
+
+		return (content2 == oldContent2) ? i : (i ^ mask2);
+	}
+
 	static SizeType getBitForIndex(SizeType ind, SizeType bitNumber)
 	{
 		const SizeType mask = (1 << bitNumber);
@@ -102,6 +129,7 @@ private:
 	}
 
 	static SizeType numberOfBits_;
+	static SymmetrySector const* sector_;
 	PsimagLite::String code_;
 	SizeType bitNumber1_;
 	SizeType bitNumber2_;
@@ -110,6 +138,9 @@ private:
 
 template<typename T>
 SizeType QuantumTwoBitGate<T>::numberOfBits_ = 0;
+
+template<typename T>
+SymmetrySector const* QuantumTwoBitGate<T>::sector_ = nullptr;
 }
 
 #endif // QUANTUM_TWO_BIT_GATE_H
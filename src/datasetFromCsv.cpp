@@ -0,0 +1,14 @@
+#include "PsimagLite.h"
+#include "Fitness/Dataset.h"
+
+int main(int argc, char* argv[])
+{
+	if (argc != 3)
+		err("USAGE: " + PsimagLite::String(argv[0]) + " file.csv file.dataset\n");
+
+	Gep::Dataset::fromCsv(argv[1], argv[2]);
+
+	Gep::Dataset dataset(argv[2]);
+	std::cout<<argv[2]<<": rows= "<<dataset.rows();
+	std::cout<<" inputs= "<<(dataset.columns() - 1)<<"\n";
+}
@@ -22,6 +22,7 @@ along with evendim. If not, see <http://www.gnu.org/licenses/>.
 #include "Fitness/Example1Fitness.h"
 #include "Fitness/Example2Fitness.h"
 #include "Fitness/Example3Fitness.h"
+#include "Fitness/DatasetFitness.h"
 
 /* PSIDOC EngineOverviewFunction
  The main loop in gep2 is
@@ -37,13 +38,16 @@ along with evendim. If not, see <http://www.gnu.org/licenses/>.
  The \verb!Engine! constructor takes an input parameters object, and an evolution object.
  */
 template<template<typename> class FitnessTemplate,
-         typename EvolutionType>
-void main1(EvolutionType& evolution, const Gep::ParametersInput& gepOptions)
+         typename EvolutionType,
+         typename FitnessParamsType>
+void main1(EvolutionType& evolution,
+           const Gep::ParametersInput& gepOptions,
+           FitnessParamsType& fitParams)
 {
 	typedef Gep::Engine<FitnessTemplate, EvolutionType> EngineType;
 
 	typename EngineType::ParametersEngineType params(gepOptions);
-	EngineType engine(params, evolution);
+	EngineType engine(params, evolution, &fitParams);
 
 	for (SizeType i = 0; i < gepOptions.generations; ++i)
 		if (engine.evolve(i) && params.options.isSet("stopEarly")) break;
@@ -54,7 +58,8 @@ void main1(EvolutionType& evolution, const Gep::ParametersInput& gepOptions)
         of using GEP to find a function knowning only some inputs and outputs.
 
         The primitives are under Primitives/PlusMinusMultiplyDivide.h, and
-        the functions under Example1.h, Example2.h and Example3.h
+        the functions under Example1.h, Example2.h and Example3.h.
+        Alternatively, gep2 fits the training data in a dataset file with DatasetFitness.h
 
         The following command line arguments to gep2 are mandatory.
         \begin{itemize}
@@ -67,6 +72,12 @@ void main1(EvolutionType& evolution, const Gep::ParametersInput& gepOptions)
         The following command line arguments to gep2 are optional.
         \begin{itemize}
         \item[-e] example. The example number to run: 1, 2 or 3. Defaults to 1.
+        \item[-d] dataset. A binary columnar dataset file to fit instead of an example;
+        the number of inputs must be the number of its columns minus one.
+        See datasetFromCsv to convert a CSV file to a dataset file.
+        \item[-b] batch. With -d, the number of random rows to use in early generations.
+        Defaults to 0, which means all rows.
+        \item[-B] generation. With -d and -b, the first generation to use all rows. Defaults to 0.
         \item[-g] genes. The number of genes to be used. Defaults to 1.
         \item[-s] seed. The seed for the random number generator.  Defaults to 1234.
         \item[-c] constants. The number of GEP constants to use. Default to 0.
@@ -75,6 +86,12 @@ void main1(EvolutionType& evolution, const Gep::ParametersInput& gepOptions)
         \item[-n] samples. The number of training samples to cache. Defaults to 100.
         \item[-v] indicates that GEP should be verbose. Defaults to false.
         \item[-S] indicates that GEP should stop when a perfect individual is found. Defaults to false.
+        \item[-T] threads. The number of threads for shared memory parallelization. Defaults to 1.
+        \item[-o] options. A comma-separated list of EngineOptions to add, for example
+        stopEarly, which stops GEP when a perfect individual is found, or
+        subtreeCache, which evaluates all individuals of a generation on the same samples
+        sharing the outputs of common subtrees, or tuneConstants, which fits the
+        constants (see -c) of promising individuals to the samples. Defaults to the empty string.
         \end{itemize}
 
         The options -v and -S take no arguments.
@@ -85,13 +102,16 @@ int main(int argc, char* argv[])
 	SizeType seed = 1234;
 	SizeType constants = 0;
 	SizeType example = 0;
+	PsimagLite::String dataset;
+	SizeType batch = 0;
+	SizeType fullBatchAfter = 0;
 	bool verbose = false;
 	Gep::ParametersInput gepOptions;
 
 	int opt = 0;
 	PsimagLite::String strUsage(argv[0]);
-	strUsage += " -i inputs -h head [-p population -t total -g genes -H chead]\n";
-	while ((opt = getopt(argc, argv,"i:h:g:s:p:t:c:H:a:e:n:Sv")) != -1) {
+	strUsage += " -i inputs -h head [-p population -t total -g genes -H chead -T threads]\n";
+	while ((opt = getopt(argc, argv,"i:h:g:s:p:t:c:H:a:e:n:ST:vo:d:b:B:")) != -1) {
 		switch (opt) {
 		case 'i':
 			inputs = atoi(optarg);
@@ -132,6 +152,21 @@ int main(int argc, char* argv[])
 		case 'S':
 			*gepOptions.options += "stopEarly";
 			break;
+		case 'T':
+			gepOptions.threads = PsimagLite::atoi(optarg);
+			break;
+		case 'o':
+			*gepOptions.options += optarg;
+			break;
+		case 'd':
+			dataset = optarg;
+			break;
+		case 'b':
+			batch = atoi(optarg);
+			break;
+		case 'B':
+			fullBatchAfter = atoi(optarg);
+			break;
 		default:
 			throw PsimagLite::RuntimeError(strUsage);
 			return 1;
@@ -150,6 +185,25 @@ int main(int argc, char* argv[])
 	if (gepOptions.genes > 1 && (gepOptions.chead == 0 || gepOptions.adfs == 0))
 		throw PsimagLite::RuntimeError(strUsage);
 
+	if (gepOptions.options->isSet("subtreeCache") && gepOptions.adfs > 0)
+		throw PsimagLite::RuntimeError("gep2: subtreeCache does not support ADFs\n");
+
+	// the cached fitness is shared by all individuals, and cannot tune their constants
+	if (gepOptions.options->isSet("subtreeCache") && gepOptions.options->isSet("tuneConstants"))
+		throw PsimagLite::RuntimeError("gep2: tuneConstants cannot be used with subtreeCache\n");
+
+	if (gepOptions.threads == 0)
+		throw PsimagLite::RuntimeError(strUsage);
+
+	if (dataset != "" && gepOptions.adfs > 0)
+		throw PsimagLite::RuntimeError("gep2: a dataset cannot be used with ADFs\n");
+
+	PsimagLite::CodeSectionParams codeSection(gepOptions.threads,
+	                                          1, // threads2
+	                                          false, // setAffinities,
+	                                          0); // threadsStackSize;
+	PsimagLite::Concurrency::setOptions(codeSection);
+
 	/* PSIDOC EvolutionInFunction
  Evolution is templated on Primitives, which represents the GEP primitives or ``operators''
  to be considered. Evolution's constructor takes a primitives object, a seed, and an verbose
@@ -160,15 +214,28 @@ int main(int argc, char* argv[])
 	typedef Gep::Evolution<PrimitivesType> EvolutionType;
 
 	PrimitivesType primitives(inputs,gepOptions.genes,constants);
-	EvolutionType evolution(primitives,seed,verbose);
+	EvolutionType evolution(primitives,
+	                        seed,
+	                        verbose,
+	                        gepOptions.options->isSet("tuneConstants"));
+
+	if (dataset != "") {
+		Gep::DatasetFitnessParams fitParams(dataset,
+		                                    batch,
+		                                    fullBatchAfter,
+		                                    gepOptions.options->isSet("tuneConstants"));
+		main1<Gep::DatasetFitness, EvolutionType>(evolution, gepOptions, fitParams);
+		return 0;
+	}
 
+	Gep::ExampleFitnessParams fitParams(*gepOptions.options);
 	if (example < 2) {
-		main1<Gep::Example1Fitness, EvolutionType>(evolution, gepOptions);
+		main1<Gep::Example1Fitness, EvolutionType>(evolution, gepOptions, fitParams);
 		return 0;
 	} else if (example == 2) {
-		main1<Gep::Example2Fitness, EvolutionType>(evolution, gepOptions);
+		main1<Gep::Example2Fitness, EvolutionType>(evolution, gepOptions, fitParams);
 		return 0;
 	}
 
-	main1<Gep::Example3Fitness, EvolutionType>(evolution, gepOptions);
+	main1<Gep::Example3Fitness, EvolutionType>(evolution, gepOptions, fitParams);
 }
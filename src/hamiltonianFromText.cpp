@@ -0,0 +1,15 @@
+#include "PsimagLite.h"
+#include "Fitness/CompactCrs.h"
+
+int main(int argc, char* argv[])
+{
+	if (argc != 3)
+		err("USAGE: " + PsimagLite::String(argv[0]) + " file.txt file.crs\n");
+
+	typedef Gep::CompactCrs<std::complex<double> > CompactCrsType;
+	CompactCrsType::fromText(argv[1], argv[2]);
+
+	CompactCrsType::MappedCrsPointerType mapped(new Gep::MappedCrs(argv[2]));
+	std::cout<<argv[2]<<": rows= "<<mapped->rows()<<" nonzeros= "<<mapped->nonZeros();
+	std::cout<<" real= "<<mapped->isReal()<<" upper= "<<mapped->isUpper()<<"\n";
+}
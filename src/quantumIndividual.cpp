@@ -173,9 +173,11 @@ int main(int argc, char* argv[])
 	if (x != inVector.size())
 		err("File " + vectorFilename + " should contain " + ttos(x) + " entries.\n");
 
+	primitives.sector().compress(inVector, "File " + vectorFilename);
 	evolution.setInput(0, inVector, threadNum);
 
 	VectorType outVector = chromosome.exec(0);
+	primitives.sector().expand(outVector);
 
 	writeVector(std::cout, outVector);
 }